@@ -0,0 +1,630 @@
+#include "bit_simulator.h"
+#include "sim_kernels.h"
+#include "thread_pool.h"
+#include "sim_jit.h"
+#include <algorithm>
+#include <sstream>
+#include <tuple>
+
+constexpr std::size_t BitSimulator::npos;
+constexpr std::size_t BitSimulator::min_slice_words;
+
+BitSimulator::BitSimulator(const Circuit *cir) :
+    input_names(cir->getInputs()),
+    output_names(cir->getOutputs()),
+    num_words(0),
+    kernel(&getActiveKernel()),
+    jit_function(nullptr),
+    evaluated_gate_words(0),
+    jit_attempted(false),
+    flip_begin(0),
+    flip_end(0)
+{
+    for (std::size_t i = 0; i < input_names.size(); ++i)
+    {
+        input_index.insert({input_names[i], i});
+        node_index.insert({cir->getNetInput(input_names[i]), i});
+        sim_nodes.push_back({FUNCTION_BUF, 0, 0, 0});
+    }
+
+    const std::size_t const0 = input_names.size(), const1 = const0 + 1;
+    node_index.insert({cir->getNetInput(CONSTANT_0), const0});
+    node_index.insert({cir->getNetInput(CONSTANT_1), const1});
+    sim_nodes.push_back({FUNCTION_BUF, 0, 0, 0});
+    sim_nodes.push_back({FUNCTION_BUF, 0, 0, 0});
+    first_gate = sim_nodes.size();
+
+    std::set<const Node *> used;
+    std::vector<const Node *> order;
+    for (const auto &po : output_names)
+    {
+        const Node *node = cir->getNetInput(po);
+        if (node && node->type == NODE_DEFAULT && used.find(node) == used.end())
+            topsort(node, used, order);
+    }
+
+    //levelization: every gate is placed after all of its fanins
+    std::map<const Node *, std::size_t> levels;
+    for (const auto *node : order)
+    {
+        std::size_t level = 1;
+        for (const auto *i : node->input)
+        {
+            auto it = levels.find(i);
+            if (it != levels.end())
+                level = std::max(level, it->second + 1);
+        }
+        levels.insert({node, level});
+    }
+    //gates of the same function and arity are kept together inside a level to be evaluated as one group
+    std::stable_sort(order.begin(), order.end(), [&levels](const Node *a, const Node *b)
+    {
+        return std::make_tuple(levels.at(a), a->function, a->input.size()) <
+               std::make_tuple(levels.at(b), b->function, b->input.size());
+    });
+
+    for (std::size_t i = 0; i < order.size(); ++i)
+        node_index.insert({order[i], first_gate + i});
+    for (const auto *node : order)
+    {
+        SimNode sim_node = {node->function, fanins.size(), 0, levels.at(node)};
+        for (const auto *i : node->input)
+        {
+            auto it = node_index.find(i);
+            fanins.push_back(it == node_index.end() ? const0 : it->second);
+        }
+        sim_node.fanin_end = fanins.size();
+        sim_nodes.push_back(sim_node);
+    }
+
+    for (const auto &po : output_names)
+    {
+        auto it = node_index.find(cir->getNetInput(po));
+        output_nodes.push_back(it == node_index.end() ? const0 : it->second);
+    }
+
+    //fanout lists in the same compressed layout as fanins
+    fanout_begin.assign(sim_nodes.size() + 1, 0);
+    for (auto fanin : fanins)
+        ++fanout_begin[fanin + 1];
+    for (std::size_t i = 0; i < sim_nodes.size(); ++i)
+        fanout_begin[i + 1] += fanout_begin[i];
+    fanouts.resize(fanins.size());
+    std::vector<std::size_t> fanout_pos(fanout_begin.begin(), fanout_begin.end() - 1);
+    for (std::size_t i = first_gate; i < sim_nodes.size(); ++i)
+    {
+        for (std::size_t k = sim_nodes[i].fanin_begin; k < sim_nodes[i].fanin_end; ++k)
+            fanouts[fanout_pos[fanins[k]]++] = i;
+    }
+
+    for (std::size_t i = first_gate; i < sim_nodes.size(); ++i)
+    {
+        const SimNode &node = sim_nodes[i];
+        const std::size_t num_srcs = node.fanin_end - node.fanin_begin;
+        if (gate_groups.empty() || sim_nodes[i - 1].level != node.level ||
+            gate_groups.back().function != node.function || gate_groups.back().num_srcs != num_srcs)
+            gate_groups.push_back({node.function, num_srcs, i, i});
+        gate_groups.back().node_end = i + 1;
+    }
+
+    event_levels.resize(sim_nodes.back().level + 1);
+    scheduled.assign(sim_nodes.size(), false);
+
+    setWordCount(1);
+}
+
+void BitSimulator::topsort(const Node *node, std::set<const Node *> &used, std::vector<const Node *> &order) const
+{
+    used.insert(node);
+    for (const auto *i : node->input)
+    {
+        if (i->type == NODE_DEFAULT && used.find(i) == used.end())
+            topsort(i, used, order);
+    }
+    order.push_back(node);
+}
+
+std::size_t BitSimulator::getInputCount() const
+{
+    return input_names.size();
+}
+
+std::size_t BitSimulator::getInputIndex(const std::string &pi) const
+{
+    auto it = input_index.find(pi);
+    return it == input_index.end() ? npos : it->second;
+}
+
+const std::string &BitSimulator::getInputName(std::size_t pi_ind) const
+{
+    return input_names.at(pi_ind);
+}
+
+std::size_t BitSimulator::getOutputCount() const
+{
+    return output_names.size();
+}
+
+std::size_t BitSimulator::getOutputIndex(const std::string &po) const
+{
+    auto it = std::find(output_names.begin(), output_names.end(), po);
+    return it == output_names.end() ? npos : it - output_names.begin();
+}
+
+std::size_t BitSimulator::getNodeCount() const
+{
+    return sim_nodes.size();
+}
+
+std::size_t BitSimulator::getNodeIndex(const Node *node) const
+{
+    auto it = node_index.find(node);
+    return it == node_index.end() ? npos : it->second;
+}
+
+void BitSimulator::setWordCount(std::size_t new_num_words)
+{
+    num_words = new_num_words;
+    values.assign(sim_nodes.size() * num_words, 0);
+
+    const std::size_t const1 = input_names.size() + 1;
+    std::fill(values.begin() + const1 * num_words, values.begin() + (const1 + 1) * num_words, ~0ULL);
+}
+
+void BitSimulator::resizeWords(std::size_t new_num_words)
+{
+    Words old_values;
+    old_values.swap(values);
+    const std::size_t old_num_words = num_words, common_words = std::min(old_num_words, new_num_words);
+    setWordCount(new_num_words);
+    for (std::size_t i = 0; i < sim_nodes.size(); ++i)
+    {
+        auto old_words = old_values.begin() + i * old_num_words;
+        std::copy(old_words, old_words + common_words, values.begin() + i * num_words);
+    }
+}
+
+std::size_t BitSimulator::getWordCount() const
+{
+    return num_words;
+}
+
+Word *BitSimulator::getInputWords(std::size_t pi_ind)
+{
+    return &values[pi_ind * num_words];
+}
+
+void BitSimulator::setInputWords(std::size_t pi_ind, const Words &words)
+{
+    std::copy(words.begin(), words.begin() + std::min(words.size(), num_words), getInputWords(pi_ind));
+}
+
+void BitSimulator::randomizeInputs(Stimulus &stimulus)
+{
+    for (std::size_t i = 0; i < input_names.size() * num_words; ++i)
+        values[i] = stimulus.nextWord();
+}
+
+void BitSimulator::simulate()
+{
+    simulateWords(0, num_words);
+}
+
+void BitSimulator::simulateWords(std::size_t word_begin, std::size_t word_end)
+{
+    word_end = std::min(word_end, num_words);
+    if (word_begin >= word_end)
+        return;
+    const std::size_t range_words = word_end - word_begin;
+
+    //only cones simulated long enough to repay the compiler run get compiled
+    if (!jit_attempted && getJitThreshold() > 0)
+    {
+        evaluated_gate_words += (sim_nodes.size() - first_gate) * range_words;
+        if (evaluated_gate_words >= getJitThreshold())
+            compileKernel();
+    }
+
+    const std::size_t num_slices = std::min(getThreadCount(), range_words / min_slice_words);
+    if (num_slices < 2)
+    {
+        simulateWords(word_begin, word_end, srcs, dsts);
+        return;
+    }
+
+    //every thread owns the same slice of words in all nodes, so levels need no synchronization
+    parallelFor(num_slices, [this, num_slices, word_begin, word_end, range_words](std::size_t slice)
+    {
+        auto sliceBound = [num_slices, word_begin, word_end, range_words](std::size_t k)
+        {
+            if (k == 0 || k == num_slices)
+                return k ? word_end : word_begin;
+            return (word_begin + range_words * k / num_slices) & ~std::size_t(7); //keep vector loads aligned
+        };
+        std::vector<const Word *> slice_srcs;
+        std::vector<Word *> slice_dsts;
+        simulateWords(sliceBound(slice), sliceBound(slice + 1), slice_srcs, slice_dsts);
+    });
+}
+
+void BitSimulator::simulateWords(std::size_t word_begin, std::size_t word_end,
+                                 std::vector<const Word *> &group_srcs, std::vector<Word *> &group_dsts)
+{
+    if (jit_function)
+    {
+        jit_function(values.data(), num_words, word_begin, word_end);
+        return;
+    }
+    for (const auto &group : gate_groups)
+        evalGroup(group, word_begin, word_end, group_srcs, group_dsts);
+}
+
+void BitSimulator::simulate(const std::vector<Words> &input_words)
+{
+    std::size_t new_num_words = input_words.empty() ? 1 : input_words.front().size();
+    if (new_num_words != num_words)
+        setWordCount(new_num_words);
+    for (std::size_t i = 0; i < input_words.size() && i < input_names.size(); ++i)
+        setInputWords(i, input_words[i]);
+    simulate();
+}
+
+void BitSimulator::simulateRandom(std::size_t new_num_words, Stimulus &stimulus)
+{
+    if (new_num_words != num_words)
+        setWordCount(new_num_words);
+    randomizeInputs(stimulus);
+    simulate();
+}
+
+const Word *BitSimulator::getNodeWords(std::size_t node_ind) const
+{
+    return &values[node_ind * num_words];
+}
+
+const Word *BitSimulator::getOutputWords(std::size_t po_ind) const
+{
+    return getNodeWords(output_nodes.at(po_ind));
+}
+
+Words BitSimulator::getOutputSignature(std::size_t po_ind) const
+{
+    const Word *words = getOutputWords(po_ind);
+    return Words(words, words + num_words);
+}
+
+void BitSimulator::evalGroup(const GateGroup &group, std::size_t word_begin, std::size_t word_end,
+                             std::vector<const Word *> &group_srcs, std::vector<Word *> &group_dsts)
+{
+    group_srcs.clear();
+    group_dsts.clear();
+    for (std::size_t node_ind = group.node_begin; node_ind < group.node_end; ++node_ind)
+    {
+        const SimNode &node = sim_nodes[node_ind];
+        for (std::size_t i = node.fanin_begin; i < node.fanin_end; ++i)
+            group_srcs.push_back(&values[fanins[i] * num_words + word_begin]);
+        group_dsts.push_back(&values[node_ind * num_words + word_begin]);
+    }
+
+    kernel->eval_group(group.function, group_dsts.data(), group_srcs.data(), group.num_srcs,
+                       group_dsts.size(), word_end - word_begin);
+}
+
+void BitSimulator::simulateTernary(const std::vector<std::size_t> &x_inputs)
+{
+    ternary_values.assign(values.begin(), values.begin() + first_gate * num_words);
+    ternary_values.resize(values.size());
+    known.assign(values.size(), 0);
+    std::fill(known.begin(), known.begin() + first_gate * num_words, ~0ULL);
+    for (auto pi_ind : x_inputs)
+    {
+        std::fill(known.begin() + pi_ind * num_words, known.begin() + (pi_ind + 1) * num_words, 0);
+        std::fill(ternary_values.begin() + pi_ind * num_words, ternary_values.begin() + (pi_ind + 1) * num_words, 0);
+    }
+
+    for (std::size_t i = first_gate; i < sim_nodes.size(); ++i)
+        evalTernary(i);
+}
+
+const Word *BitSimulator::getKnownWords(std::size_t node_ind) const
+{
+    return &known[node_ind * num_words];
+}
+
+const Word *BitSimulator::getTernaryWords(std::size_t node_ind) const
+{
+    return &ternary_values[node_ind * num_words];
+}
+
+bool BitSimulator::provesIndependence(const std::vector<std::size_t> &x_inputs, std::size_t po_ind, std::size_t max_enum_inputs)
+{
+    //inputs with the largest fanout are the most likely to fix the output, so they are enumerated
+    std::vector<bool> is_x(input_names.size(), false);
+    for (auto pi_ind : x_inputs)
+        is_x[pi_ind] = true;
+    std::vector<std::size_t> enum_inputs;
+    for (std::size_t i = 0; i < input_names.size(); ++i)
+    {
+        if (!is_x[i])
+            enum_inputs.push_back(i);
+    }
+    std::stable_sort(enum_inputs.begin(), enum_inputs.end(), [this](std::size_t a, std::size_t b)
+    {
+        return fanout_begin[a + 1] - fanout_begin[a] > fanout_begin[b + 1] - fanout_begin[b];
+    });
+    if (enum_inputs.size() > max_enum_inputs)
+        enum_inputs.resize(max_enum_inputs);
+
+    //every assignment of the enumerated inputs is one bit; below 6 inputs the patterns repeat inside the word
+    const std::size_t num_enum = enum_inputs.size(),
+                      new_num_words = num_enum > 6 ? std::size_t(1) << (num_enum - 6) : 1;
+    setWordCount(new_num_words);
+    std::vector<std::size_t> all_x;
+    for (std::size_t i = 0; i < input_names.size(); ++i)
+    {
+        auto it = std::find(enum_inputs.begin(), enum_inputs.end(), i);
+        if (it == enum_inputs.end())
+        {
+            all_x.push_back(i);
+            continue;
+        }
+        const std::size_t var = it - enum_inputs.begin();
+        Word *words = getInputWords(i);
+        for (std::size_t w = 0; w < num_words; ++w)
+        {
+            if (var < 6)
+            {
+                Word mask = 0;
+                for (std::size_t bit = 0; bit < 64; ++bit)
+                    mask |= Word((bit >> var) & 1) << bit;
+                words[w] = mask;
+            }
+            else
+            {
+                words[w] = ((w >> (var - 6)) & 1) ? ~0ULL : 0;
+            }
+        }
+    }
+    simulateTernary(all_x);
+
+    //the output is binary on every cube, so it is constant over each cube and cannot depend on x_inputs
+    const Word *out_known = getKnownWords(output_nodes.at(po_ind));
+    return std::all_of(out_known, out_known + num_words, [](Word word) { return word == ~0ULL; });
+}
+
+bool BitSimulator::provesConstant(bool &value, std::size_t po_ind)
+{
+    setWordCount(1);
+    std::vector<std::size_t> all_x;
+    for (std::size_t i = 0; i < input_names.size(); ++i)
+        all_x.push_back(i);
+    simulateTernary(all_x);
+
+    const std::size_t out_ind = output_nodes.at(po_ind);
+    value = *getTernaryWords(out_ind) & 1;
+    return *getKnownWords(out_ind) & 1;
+}
+
+void BitSimulator::generateSensitizingWords(std::size_t pi_ind, Stimulus &stimulus, std::size_t po_ind, std::size_t max_rounds)
+{
+    randomizeInputs(stimulus);
+    const std::size_t out_ind = output_nodes.at(po_ind);
+    for (std::size_t round = 0; round < max_rounds; ++round)
+    {
+        //a bit with a known output cannot change when pi_ind flips, so only those bits are drawn again
+        simulateTernary({pi_ind});
+        const Word *out_known = getKnownWords(out_ind);
+        if (std::all_of(out_known, out_known + num_words, [](Word word) { return word == 0; }))
+            return;
+
+        for (std::size_t i = 0; i < input_names.size(); ++i)
+        {
+            if (i == pi_ind)
+                continue;
+            Word *words = getInputWords(i);
+            for (std::size_t w = 0; w < num_words; ++w)
+                words[w] = (words[w] & ~out_known[w]) | (stimulus.nextWord() & out_known[w]);
+        }
+    }
+}
+
+void BitSimulator::evalTernary(std::size_t node_ind)
+{
+    const SimNode &node = sim_nodes[node_ind];
+    Word *dst_value = &ternary_values[node_ind * num_words], *dst_known = &known[node_ind * num_words];
+    const bool inverted = node.function == FUNCTION_NAND || node.function == FUNCTION_NOR ||
+                          node.function == FUNCTION_XNOR || node.function == FUNCTION_NOT;
+
+    for (std::size_t w = 0; w < num_words; ++w)
+    {
+        //value and known mask of the gate before the output inversion
+        Word value = 0, is_known = ~0ULL;
+        switch (node.function)
+        {
+        case FUNCTION_AND:
+        case FUNCTION_NAND:
+        case FUNCTION_OR:
+        case FUNCTION_NOR:
+        {
+            //a known controlling value decides the gate, otherwise all fanins must be known
+            const bool is_and = node.function == FUNCTION_AND || node.function == FUNCTION_NAND;
+            Word controlled = 0, all_known = ~0ULL, acc = is_and ? ~0ULL : 0;
+            for (std::size_t i = node.fanin_begin; i < node.fanin_end; ++i)
+            {
+                const std::size_t src = fanins[i] * num_words + w;
+                const Word v = ternary_values[src], k = known[src];
+                controlled |= k & (is_and ? ~v : v);
+                all_known &= k;
+                acc = is_and ? (acc & v) : (acc | v);
+            }
+            is_known = controlled | all_known;
+            value = is_and ? (acc & ~controlled) : (acc | controlled);
+            break;
+        }
+        case FUNCTION_XOR:
+        case FUNCTION_XNOR:
+            for (std::size_t i = node.fanin_begin; i < node.fanin_end; ++i)
+            {
+                const std::size_t src = fanins[i] * num_words + w;
+                value ^= ternary_values[src];
+                is_known &= known[src];
+            }
+            break;
+        default:
+            if (node.fanin_begin != node.fanin_end)
+            {
+                const std::size_t src = fanins[node.fanin_begin] * num_words + w;
+                value = ternary_values[src];
+                is_known = known[src];
+            }
+            break;
+        }
+        if (inverted)
+            value = ~value;
+        dst_value[w] = value & is_known;
+        dst_known[w] = is_known;
+    }
+}
+
+void BitSimulator::flipInputs(const std::vector<std::size_t> &pi_inds, std::size_t word_begin, std::size_t word_end)
+{
+    flip_begin = word_begin;
+    flip_end = std::min(word_end, num_words);
+    const std::size_t flip_words = flip_end - flip_begin;
+    for (auto pi_ind : pi_inds)
+    {
+        saveNode(pi_ind);
+        Word *words = getInputWords(pi_ind);
+        for (std::size_t w = flip_begin; w < flip_end; ++w)
+            words[w] = ~words[w];
+        scheduleFanouts(pi_ind);
+    }
+
+    //fanouts are always on higher levels, so a single ascending sweep settles every event
+    event_value.resize(flip_words);
+    for (std::size_t level = 1; level < event_levels.size(); ++level)
+    {
+        for (auto node_ind : event_levels[level])
+        {
+            scheduled[node_ind] = false;
+
+            const SimNode &node = sim_nodes[node_ind];
+            srcs.clear();
+            for (std::size_t i = node.fanin_begin; i < node.fanin_end; ++i)
+                srcs.push_back(&values[fanins[i] * num_words + flip_begin]);
+            kernel->eval(node.function, event_value.data(), srcs.data(), srcs.size(), flip_words);
+
+            Word *words = &values[node_ind * num_words + flip_begin];
+            if (std::equal(event_value.begin(), event_value.end(), words))
+                continue;
+
+            saveNode(node_ind);
+            std::copy(event_value.begin(), event_value.end(), words);
+            scheduleFanouts(node_ind);
+        }
+        event_levels[level].clear();
+    }
+}
+
+void BitSimulator::restoreFlips()
+{
+    //reverse order, so a node saved twice ends up with its oldest value
+    for (std::size_t i = saved_nodes.size(); i-- > 0;)
+    {
+        auto saved = saved_values.begin() + i * (flip_end - flip_begin);
+        std::copy(saved, saved + (flip_end - flip_begin), values.begin() + saved_nodes[i] * num_words + flip_begin);
+    }
+    saved_nodes.clear();
+    saved_values.clear();
+}
+
+void BitSimulator::saveNode(std::size_t node_ind)
+{
+    saved_nodes.push_back(node_ind);
+    saved_values.insert(saved_values.end(), values.begin() + node_ind * num_words + flip_begin,
+                        values.begin() + node_ind * num_words + flip_end);
+}
+
+void BitSimulator::scheduleFanouts(std::size_t node_ind)
+{
+    for (std::size_t i = fanout_begin[node_ind]; i < fanout_begin[node_ind + 1]; ++i)
+    {
+        std::size_t fanout = fanouts[i];
+        if (!scheduled[fanout])
+        {
+            scheduled[fanout] = true;
+            event_levels[sim_nodes[fanout].level].push_back(fanout);
+        }
+    }
+}
+
+void BitSimulator::setKernel(KernelType type)
+{
+    kernel = &getKernel(type);
+    jit_function = nullptr;
+}
+
+bool BitSimulator::compileKernel()
+{
+    jit_attempted = true;
+    jit_function = compileJit(generateJitSource());
+    return jit_function != nullptr;
+}
+
+std::string BitSimulator::generateJitSource() const
+{
+    std::stringstream ss;
+    ss << "#include <stddef.h>\n#include <stdint.h>\n\n";
+    ss << "typedef uint64_t tile __attribute__((vector_size(64), aligned(8), may_alias));\n\n";
+    ss << "#define BODY \\\n";
+    const std::size_t const0 = input_names.size(), const1 = const0 + 1;
+    for (std::size_t i = first_gate; i < sim_nodes.size(); ++i)
+    {
+        const SimNode &node = sim_nodes[i];
+        const char *op = nullptr; //gates without an operation copy their first fanin
+        switch (node.function)
+        {
+        case FUNCTION_AND:
+        case FUNCTION_NAND:
+            op = " & ";
+            break;
+        case FUNCTION_OR:
+        case FUNCTION_NOR:
+            op = " | ";
+            break;
+        case FUNCTION_XOR:
+        case FUNCTION_XNOR:
+            op = " ^ ";
+            break;
+        default:
+            break;
+        }
+        const bool inverted = node.function == FUNCTION_NAND || node.function == FUNCTION_NOR ||
+                              node.function == FUNCTION_XNOR || node.function == FUNCTION_NOT;
+
+        ss << "    X(" << i << ") = " << (inverted ? "~(" : "(");
+        if (node.fanin_begin == node.fanin_end)
+        {
+            //same identities as the interpreted kernels, read from the constant nodes
+            ss << "X(" << ((op && op[1] == '&') ? const1 : const0) << ")";
+        }
+        else
+        {
+            const std::size_t fanin_end = op ? node.fanin_end : node.fanin_begin + 1;
+            for (std::size_t k = node.fanin_begin; k < fanin_end; ++k)
+                ss << (k == node.fanin_begin ? "" : op) << "X(" << fanins[k] << ")";
+        }
+        ss << "); \\\n";
+    }
+    ss << "\n";
+
+    //the same body runs on tiles of 8 words as vector operations and on the remaining words one by one
+    ss << "void simulate_cone(uint64_t *v, size_t n, size_t b, size_t e)\n{\n";
+    ss << "    size_t w = b;\n";
+    ss << "#define X(i) (*(tile *)(v + (i) * n + w))\n";
+    ss << "    for (; w + 8 <= e; w += 8)\n    {\n        BODY\n    }\n";
+    ss << "#undef X\n#define X(i) v[(i) * n + w]\n";
+    ss << "    for (; w < e; ++w)\n    {\n        BODY\n    }\n";
+    ss << "}\n";
+    return ss.str();
+}
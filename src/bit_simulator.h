@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstdint>
+#include "circuit.h"
+#include "stimulus.h"
+
+struct GateKernel;
+enum class KernelType;
+using JitFunction = void (*)(Word *values, std::size_t num_words, std::size_t word_begin, std::size_t word_end);
+
+using Words = std::vector<Word>;
+
+/// Поразрядно-параллельная симуляция схемы по уровням
+class BitSimulator
+{
+public:
+    BitSimulator(const Circuit *cir);
+
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    std::size_t getInputCount() const;
+    std::size_t getInputIndex(const std::string &pi) const; ///< Номер входа или npos
+    const std::string &getInputName(std::size_t pi_ind) const;
+    std::size_t getOutputCount() const;
+    std::size_t getOutputIndex(const std::string &po) const; ///< Номер выхода или npos
+    std::size_t getNodeCount() const; ///< Число узлов, включая входы и константы
+    std::size_t getNodeIndex(const Node *node) const; ///< Номер узла исходной схемы или npos
+
+    void setWordCount(std::size_t num_words); ///< Число слов (по 64 шаблона) на узел
+    void resizeWords(std::size_t num_words); ///< То же с сохранением значений всех узлов в прежних словах; новые слова не вычисляются
+    std::size_t getWordCount() const;
+
+    Word *getInputWords(std::size_t pi_ind); ///< Слова входа для непосредственного заполнения
+    void setInputWords(std::size_t pi_ind, const Words &words);
+    void randomizeInputs(Stimulus &stimulus); ///< Случайные слова на всех входах
+
+    void simulate(); ///< Вычисление всех узлов для текущих слов входов
+    void simulateWords(std::size_t word_begin, std::size_t word_end); ///< Вычисление всех узлов только в словах [word_begin, word_end)
+    void simulate(const std::vector<Words> &input_words); ///< input_words[pi][word]
+    void simulateRandom(std::size_t num_words, Stimulus &stimulus);
+    void setKernel(KernelType type); ///< Принудительный выбор ядра (для сравнения производительности)
+    bool compileKernel(); ///< Немедленная JIT-компиляция конуса, не дожидаясь порога getJitThreshold()
+
+    /// Троичная симуляция (0/1/X): входы x_inputs получают X, остальные - текущие слова входов;
+    /// результат хранится отдельно от двоичных значений
+    void simulateTernary(const std::vector<std::size_t> &x_inputs);
+    const Word *getKnownWords(std::size_t node_ind) const; ///< Разряды, в которых значение узла определено (не X)
+    const Word *getTernaryWords(std::size_t node_ind) const; ///< Значение узла в определённых разрядах, 0 в прочих
+
+    /// Доказательство независимости выхода от x_inputs: перебираются все наборы не более max_enum_inputs
+    /// остальных входов с наибольшим ветвлением, прочие получают X; false - доказательство не найдено.
+    /// Текущие слова входов теряются
+    bool provesIndependence(const std::vector<std::size_t> &x_inputs, std::size_t po_ind = 0, std::size_t max_enum_inputs = 10);
+    /// Доказательство константности выхода: все входы получают X, а выход остаётся определённым. Число слов становится 1
+    bool provesConstant(bool &value, std::size_t po_ind = 0);
+    /// Случайные слова входов, в разрядах которых выход может зависеть от pi_ind: разряды, где выход определён
+    /// при X на pi_ind, перевыбираются до max_rounds раз. Двоичная симуляция не выполняется
+    void generateSensitizingWords(std::size_t pi_ind, Stimulus &stimulus, std::size_t po_ind = 0, std::size_t max_rounds = 8);
+
+    /// Инверсия входов в словах [word_begin, word_end) с пересчётом только тех узлов, значения которых изменились (после simulate)
+    void flipInputs(const std::vector<std::size_t> &pi_inds, std::size_t word_begin = 0, std::size_t word_end = npos);
+    void restoreFlips(); ///< Возврат значений, действовавших до flipInputs
+
+    const Word *getNodeWords(std::size_t node_ind) const;
+    const Word *getOutputWords(std::size_t po_ind = 0) const;
+    Words getOutputSignature(std::size_t po_ind = 0) const;
+private:
+    /// Узел в уровневом массиве
+    struct SimNode
+    {
+        Function function;
+        std::size_t fanin_begin, fanin_end; ///< Диапазон в fanins
+        std::size_t level;
+    };
+
+    /// Подряд идущие элементы одного уровня с одинаковыми функцией и числом входов
+    struct GateGroup
+    {
+        Function function;
+        std::size_t num_srcs;
+        std::size_t node_begin, node_end;
+    };
+
+    std::vector<std::string> input_names;
+    std::map<std::string, std::size_t> input_index;
+    std::vector<std::string> output_names;
+    std::vector<std::size_t> output_nodes;
+    std::map<const Node *, std::size_t> node_index;
+
+    std::size_t first_gate; ///< Узлы [0, first_gate) - входы и константы 0, 1
+    std::vector<SimNode> sim_nodes; ///< Элементы упорядочены по уровням, внутри уровня - по функции и числу входов
+    std::vector<GateGroup> gate_groups;
+    std::vector<std::size_t> fanins;
+    std::vector<std::size_t> fanout_begin; ///< fanouts[fanout_begin[i], fanout_begin[i + 1]) - элементы, читающие узел i
+    std::vector<std::size_t> fanouts;
+
+    std::size_t num_words;
+    Words values; ///< values[node * num_words + word]
+
+    const GateKernel *kernel; ///< Ядро вычисления элементов, выбранное при создании симулятора
+    JitFunction jit_function; ///< Скомпилированная симуляция всех элементов, заменяет kernel в simulate()
+    std::size_t evaluated_gate_words; ///< Счётчик до JIT-компиляции
+    bool jit_attempted;
+    std::vector<const Word *> srcs;
+    std::vector<Word *> dsts;
+
+    std::vector<std::vector<std::size_t>> event_levels; ///< Очереди изменившихся узлов по уровням
+    std::vector<bool> scheduled;
+    std::size_t flip_begin, flip_end; ///< Слова, инвертированные flipInputs
+    std::vector<std::size_t> saved_nodes; ///< Узлы, изменённые flipInputs
+    Words saved_values; ///< Их прежние значения
+    Words event_value;
+
+    Words ternary_values; ///< Двухпроводное представление троичных значений: значение и
+    Words known;          ///< маска определённости, в той же раскладке, что values
+
+    static constexpr std::size_t min_slice_words = 64; ///< Меньшие срезы слов не делятся между потоками
+
+    std::string generateJitSource() const; ///< Прямолинейный C-код: по одному поразрядному выражению на элемент
+    void topsort(const Node *node, std::set<const Node *> &used, std::vector<const Node *> &order) const;
+    void simulateWords(std::size_t word_begin, std::size_t word_end,
+                       std::vector<const Word *> &group_srcs, std::vector<Word *> &group_dsts); ///< Все элементы на срезе слов [word_begin, word_end)
+    void evalGroup(const GateGroup &group, std::size_t word_begin, std::size_t word_end,
+                   std::vector<const Word *> &group_srcs, std::vector<Word *> &group_dsts);
+    void evalTernary(std::size_t node_ind);
+    void saveNode(std::size_t node_ind);
+    void scheduleFanouts(std::size_t node_ind);
+};
@@ -1,93 +1,175 @@
 #include "checker.h"
-#include "defines.h"
 
-#include <cstring>
-#include <unistd.h>
+#include <cstdlib>
 
-// procedures to start and stop the ABC framework
-// (should be called before and after the ABC procedures are called)
-extern "C" void   Abc_Start();
-extern "C" void   Abc_Stop();
+// the MiniSat-based solver of the ABC library (literals are 2 * var + complement)
+#include "sat/bsat/satSolver.h"
 
-// procedures to get the ABC framework and execute commands in it
-extern "C" void * Abc_FrameGetGlobalFrame();
-extern "C" int    Cmd_CommandExecute( void * pAbc, char * sCommand );
-
-int checkMiter(const char *miter_file)
+namespace
 {
-    // save stdout's descriptor
-    int old_fd = dup(1);
-
-    // declare variables
-    static void * pAbc = nullptr;
-    char Command[BUF_LEN];
-    char Result[BUF_LEN];
-
-    // start the ABC framework
-    if (!pAbc) {
-        Abc_Start();
-        pAbc = Abc_FrameGetGlobalFrame();
-    }
-
-    sprintf(Command, "read_verilog %s", miter_file);
-
-    // perform verification
-    if (Cmd_CommandExecute(pAbc, Command)) {
-        fprintf( stdout, "Cannot execute command \"%s\".\n", Command );
-        dup2(old_fd, 1);
-        close(old_fd);
-        return FAIL;
-    }
-
-    memset(Command, 0, strlen(Command));
-    sprintf(Command, "sat");
-
-    // redirect ABC's output into Result[]
-    if (freopen("/dev/null", "a", stdout) == NULL) {
-        dup2(old_fd, 1);
-        close(old_fd);
-        return FAIL;
-    }
-    setbuffer(stdout, Result, BUF_LEN);
-
-    if (Cmd_CommandExecute(pAbc, Command)) {
-        fprintf( stdout, "Cannot execute command \"%s\".\n", Command );
-        dup2(old_fd, 1);
-        close(old_fd);
-        return FAIL;
-    }
-
-    if (freopen("/dev/tty", "a", stdout) == NULL) {
-        dup2(old_fd, 1);
-        close(old_fd);
-        return FAIL;
-    }
-
-    // stop the ABC framework
-    //Abc_Stop();
-
-    dup2(old_fd, 1);
-    close(old_fd);
-
-    printf("Miter check: %s\n", Result);
-    if (strstr(Result, "UNSATISFIABLE")) {
-        return 1;
-    }
-    return 0;
+    // Tseitin encoding of the nodes feeding the miter outputs
+    class MiterEncoder
+    {
+    public:
+        MiterEncoder(sat_solver *solver) :
+            solver(solver),
+            num_vars(0),
+            consistent(true)
+        {}
+
+        int getLiteral(Node *root)
+        {
+            //fanins are encoded first in a post-order walk with an explicit stack, deep netlists would overflow the call stack
+            std::vector<std::pair<Node *, std::size_t>> stack;
+            if (!literals.count(root))
+                stack.push_back({root, 0});
+            while (!stack.empty())
+            {
+                Node *node = stack.back().first;
+                const std::size_t next = stack.back().second++;
+                if (next < node->input.size())
+                {
+                    if (!literals.count(node->input[next]))
+                        stack.push_back({node->input[next], 0});
+                    continue;
+                }
+                stack.pop_back();
+
+                std::vector<int> fanins;
+                for (auto *fanin : node->input)
+                    fanins.push_back(literals.at(fanin));
+
+                const int lit = newVar();
+                literals.insert({node, lit});
+                if (node->type == NODE_CONSTANT)
+                    addClause({node->value ? lit : negate(lit)});
+                else if (node->type == NODE_DEFAULT)
+                    encodeGate(node->function, lit, fanins);
+            }
+            return literals.at(root);
+        }
+
+        void addClause(std::vector<int> clause)
+        {
+            //the solver rejects a clause that conflicts at the root level, the problem is UNSAT then
+            consistent = sat_solver_addclause(solver, clause.data(), clause.data() + clause.size()) && consistent;
+        }
+
+        bool isConsistent() const
+        {
+            return consistent;
+        }
+    private:
+        sat_solver *solver;
+        int num_vars;
+        bool consistent;
+        std::map<Node *, int> literals;
+
+        static int negate(int lit)
+        {
+            return lit ^ 1;
+        }
+
+        int newVar()
+        {
+            sat_solver_setnvars(solver, ++num_vars);
+            return 2 * (num_vars - 1);
+        }
+
+        void encodeGate(Function function, int out, const std::vector<int> &fanins)
+        {
+            //inverting functions constrain the complemented output literal
+            if (function == FUNCTION_NAND || function == FUNCTION_NOR || function == FUNCTION_XNOR || function == FUNCTION_NOT)
+                out = negate(out);
+
+            switch (function)
+            {
+            case FUNCTION_AND:
+            case FUNCTION_NAND:
+            case FUNCTION_OR:
+            case FUNCTION_NOR:
+            {
+                //OR is AND of the complemented fanins with the complemented output
+                const bool is_and = function == FUNCTION_AND || function == FUNCTION_NAND;
+                const int y = is_and ? out : negate(out);
+                std::vector<int> big_clause = {y};
+                for (int fanin : fanins)
+                {
+                    const int a = is_and ? fanin : negate(fanin);
+                    addClause({negate(y), a});
+                    big_clause.push_back(negate(a));
+                }
+                addClause(big_clause);
+                break;
+            }
+            case FUNCTION_XOR:
+            case FUNCTION_XNOR:
+            {
+                if (fanins.empty())
+                {
+                    addClause({negate(out)});
+                    break;
+                }
+                //n-ary XOR is chained through auxiliary variables
+                int acc = fanins.front();
+                for (std::size_t i = 1; i < fanins.size(); ++i)
+                {
+                    const int t = (i + 1 == fanins.size()) ? out : newVar(), b = fanins[i];
+                    addClause({negate(t), acc, b});
+                    addClause({negate(t), negate(acc), negate(b)});
+                    addClause({t, negate(acc), b});
+                    addClause({t, acc, negate(b)});
+                    acc = t;
+                }
+                if (fanins.size() == 1)
+                {
+                    addClause({negate(out), acc});
+                    addClause({out, negate(acc)});
+                }
+                break;
+            }
+            default:
+                if (fanins.empty())
+                {
+                    addClause({negate(out)});
+                    break;
+                }
+                addClause({negate(out), fanins.front()});
+                addClause({out, negate(fanins.front())});
+                break;
+            }
+        }
+    };
 }
 
-bool checkMiter(Circuit *miter)
+bool checkMiter(Circuit *miter, InVector *counterexample)
 {
-    int old_fd = dup(1);
-    const char *tmp_file = "tmp_file";
-    freopen(tmp_file, "w", stdout);
-
-    miter->print();
-    bool result = checkMiter(tmp_file);
-
-    unlink(tmp_file);
-    dup2(old_fd, 1);
-    close(old_fd);
+    sat_solver *solver = sat_solver_new();
+    MiterEncoder encoder(solver);
+
+    //the miter is satisfiable when any of its outputs can be 1
+    std::vector<int> any_output;
+    for (const auto &po : miter->getOutputs())
+        any_output.push_back(encoder.getLiteral(miter->getNetInput(po)));
+    encoder.addClause(any_output);
+
+    std::vector<std::pair<std::string, int>> input_vars;
+    for (const auto &pi : miter->getInputs())
+        input_vars.push_back({pi, encoder.getLiteral(miter->getNetInput(pi)) / 2});
+
+    //an undecided result (l_Undef) proves nothing, so only l_False counts as UNSAT
+    const int result = encoder.isConsistent() ? sat_solver_solve(solver, nullptr, nullptr, 0, 0, 0, 0) : l_False;
+    if (result == l_True && counterexample)
+    {
+        std::vector<int> vars;
+        for (const auto &it : input_vars)
+            vars.push_back(it.second);
+        int *model = Sat_SolverGetModel(solver, vars.data(), vars.size());
+        for (std::size_t i = 0; i < input_vars.size(); ++i)
+            (*counterexample)[input_vars[i].first] = model[i];
+        free(model);
+    }
 
-    return result;
+    sat_solver_delete(solver);
+    return result == l_False;
 }
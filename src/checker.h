@@ -2,4 +2,6 @@
 
 #include "circuit.h"
 
-bool checkMiter(Circuit *miter);
+// true only when the miter is proven unsatisfiable, an undecided solver result is not a proof;
+// counterexample receives the satisfying assignment of the miter inputs when the miter is satisfiable
+bool checkMiter(Circuit *miter, InVector *counterexample = nullptr);
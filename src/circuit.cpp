@@ -15,6 +15,10 @@ Node::Node(NodeType _type, bool _value) : name(), type(_type),
     input(), output(), input_names(), output_name() {}
 
 bool Node::eval() const {
+    //constants are never cached: the shared node_constant_0/1 are evaluated by several workers at once
+    if (type == NODE_CONSTANT) {
+        return value;
+    }
     if (lazy) {
         return lazy_value;
     }
@@ -80,8 +84,6 @@ bool Node::eval() const {
         }
     } else if (type == NODE_INPUT) {
         result = value;
-    } else if (type == NODE_CONSTANT) {
-        result = value;
     }
     lazy = true;
     return lazy_value = result;
@@ -112,6 +114,10 @@ void Circuit::setName(const std::string &new_name) {
     name = new_name;
 }
 
+const std::string &Circuit::getName() const {
+    return name;
+}
+
 Node *Circuit::addNode(NodeType type, Function function) {
     Node *node = new Node(type, function);
     if (type == NODE_DEFAULT) {
@@ -307,6 +313,270 @@ void Circuit::sortNodes() {
     nodes = result;
 }
 
+namespace
+{
+    using Literal = std::pair<std::string, bool>; ///< Нет и признак инверсии
+
+    /// Элемент нормализованной схемы
+    struct NormGate
+    {
+        std::string name;
+        Function base; ///< FUNCTION_AND, FUNCTION_OR, FUNCTION_XOR или исходная функция непреобразуемого элемента
+        bool inv;
+        bool opaque; ///< Элемент не участвует в преобразованиях (_cut)
+        bool alive;
+        std::vector<Literal> ins;
+    };
+
+    Function normFunction(Function base, bool inv)
+    {
+        switch (base)
+        {
+        case FUNCTION_AND:
+            return inv ? FUNCTION_NAND : FUNCTION_AND;
+        case FUNCTION_OR:
+            return inv ? FUNCTION_NOR : FUNCTION_OR;
+        case FUNCTION_XOR:
+            return inv ? FUNCTION_XNOR : FUNCTION_XOR;
+        default:
+            return base;
+        }
+    }
+}
+
+void Circuit::normalize()
+{
+    sortNodes();
+
+    std::set<std::string> is_po(outputs.begin(), outputs.end());
+    std::map<std::string, Literal> lits;
+    std::map<std::string, std::string> inv_nets; ///< Нет, на котором доступна инверсия нета
+    auto resolve = [&lits](const std::string &net) -> Literal
+    {
+        auto it = lits.find(net);
+        return it == lits.end() ? Literal(net, false) : it->second;
+    };
+
+    //buffer and inverter chains are replaced by literals of their sources
+    std::vector<std::string> order;
+    std::map<std::string, NormGate> gates;
+    for (auto *node : nodes)
+    {
+        if (node->type != NODE_DEFAULT)
+            continue;
+
+        const std::string &out = node->output_name;
+        if ((node->function == FUNCTION_BUF || node->function == FUNCTION_NOT) && node->input_names.size() == 1)
+        {
+            Literal lit = resolve(node->input_names.front());
+            if (node->function == FUNCTION_NOT)
+                lit.second = !lit.second;
+            if (lit.second && (lit.first == CONSTANT_0 || lit.first == CONSTANT_1))
+                lit = Literal(lit.first == CONSTANT_0 ? CONSTANT_1 : CONSTANT_0, false);
+            lits[out] = lit;
+            if (lit.second && (!inv_nets.count(lit.first) || is_po.count(out)))
+                inv_nets[lit.first] = out;
+            continue;
+        }
+
+        NormGate gate = {node->name, node->function, false, false, true, {}};
+        switch (node->function)
+        {
+        case FUNCTION_NAND:
+            gate.base = FUNCTION_AND;
+            gate.inv = true;
+            break;
+        case FUNCTION_NOR:
+            gate.base = FUNCTION_OR;
+            gate.inv = true;
+            break;
+        case FUNCTION_XNOR:
+            gate.base = FUNCTION_XOR;
+            gate.inv = true;
+            break;
+        case FUNCTION_AND:
+        case FUNCTION_OR:
+        case FUNCTION_XOR:
+            break;
+        default:
+            gate.opaque = true;
+            break;
+        }
+        for (const auto &in : node->input_names)
+            gate.ins.push_back(resolve(in));
+        order.push_back(out);
+        gates.insert({out, gate});
+    }
+
+    std::map<std::string, std::size_t> pos_refs, neg_refs;
+    for (const auto &out : order)
+    {
+        for (const auto &in : gates.at(out).ins)
+            ++(in.second ? neg_refs : pos_refs)[in.first];
+    }
+    for (const auto &po : outputs)
+    {
+        Literal lit = resolve(po);
+        if (lit.first != po)
+            ++(lit.second ? neg_refs : pos_refs)[lit.first];
+    }
+    auto refs = [&pos_refs, &neg_refs](const std::string &net)
+    {
+        return (pos_refs.count(net) ? pos_refs.at(net) : 0) + (neg_refs.count(net) ? neg_refs.at(net) : 0);
+    };
+
+    //trees of same-type gates with single fanout are merged into wide gates
+    for (const auto &out : order)
+    {
+        NormGate &gate = gates.at(out);
+        if (gate.opaque)
+            continue;
+
+        std::vector<Literal> ins;
+        for (const auto &in : gate.ins)
+        {
+            auto it = gates.find(in.first);
+            bool merge = it != gates.end() && !it->second.opaque && it->second.base == gate.base &&
+                         !is_po.count(in.first) && refs(in.first) == 1 &&
+                         (gate.base == FUNCTION_XOR || it->second.inv == in.second);
+            if (!merge)
+            {
+                ins.push_back(in);
+                continue;
+            }
+            if (gate.base == FUNCTION_XOR && (it->second.inv != in.second))
+                gate.inv = !gate.inv;
+            ins.insert(ins.end(), it->second.ins.begin(), it->second.ins.end());
+            it->second.alive = false;
+        }
+        gate.ins = ins;
+    }
+
+    //gates used only by one output or only inverted take over the name of that net and absorb the inversion
+    std::map<std::string, Literal> renamed;
+    for (const auto &po : outputs)
+    {
+        Literal lit = resolve(po);
+        auto it = gates.find(lit.first);
+        if (lit.first == po || it == gates.end() || it->second.opaque || is_po.count(lit.first) ||
+            refs(lit.first) != 1 || renamed.count(lit.first))
+            continue;
+        renamed[lit.first] = Literal(po, lit.second);
+    }
+    for (const auto &out : order)
+    {
+        const NormGate &gate = gates.at(out);
+        if (!gate.alive || gate.opaque || is_po.count(out) || renamed.count(out) ||
+            pos_refs.count(out) || !neg_refs.count(out) || !inv_nets.count(out))
+            continue;
+        renamed[out] = Literal(inv_nets.at(out), true);
+    }
+    auto translate = [&renamed](const Literal &lit) -> Literal
+    {
+        auto it = renamed.find(lit.first);
+        if (it == renamed.end())
+            return lit;
+        return Literal(it->second.first, lit.second != it->second.second);
+    };
+
+    std::vector<NormGate> result;
+    std::vector<std::string> result_outs;
+    std::set<std::string> driven;
+    auto emit = [&result, &result_outs, &driven](const std::string &out, const NormGate &gate)
+    {
+        if (driven.count(out))
+            return;
+        driven.insert(out);
+        result.push_back(gate);
+        result_outs.push_back(out);
+    };
+
+    std::set<std::string> needed_inversions;
+    for (const auto &out : order)
+    {
+        NormGate gate = gates.at(out);
+        if (!gate.alive)
+            continue;
+
+        std::string new_out = out;
+        if (renamed.count(out))
+        {
+            new_out = renamed.at(out).first;
+            gate.inv = gate.inv != renamed.at(out).second;
+        }
+
+        bool all_inverted = !gate.ins.empty();
+        for (auto &in : gate.ins)
+        {
+            in = translate(in);
+            all_inverted = all_inverted && in.second;
+        }
+
+        if (gate.base == FUNCTION_XOR && !gate.opaque)
+        {
+            for (auto &in : gate.ins)
+            {
+                gate.inv = gate.inv != in.second;
+                in.second = false;
+            }
+        }
+        else if (all_inverted && !gate.opaque)
+        {
+            //De Morgan: AND(!a, !b) = NOR(a, b)
+            gate.base = (gate.base == FUNCTION_AND) ? FUNCTION_OR : FUNCTION_AND;
+            gate.inv = !gate.inv;
+            for (auto &in : gate.ins)
+                in.second = false;
+        }
+        else
+        {
+            for (auto &in : gate.ins)
+            {
+                if (in.second)
+                    needed_inversions.insert(in.first);
+            }
+        }
+        emit(new_out, gate);
+    }
+
+    for (const auto &po : outputs)
+    {
+        if (driven.count(po))
+            continue;
+        Literal lit = translate(resolve(po));
+        if (lit.first == po)
+            continue;
+        emit(po, {"", lit.second ? FUNCTION_NOT : FUNCTION_BUF, false, true, true, {Literal(lit.first, false)}});
+    }
+    for (const auto &net : needed_inversions)
+        emit(inv_nets.at(net), {"", FUNCTION_NOT, false, true, true, {Literal(net, false)}});
+
+    //rebuilding nodes and nets of the circuit
+    for (auto *node : nodes)
+        delete node;
+    nodes.clear();
+
+    for (auto it = nets.begin(); it != nets.end();)
+    {
+        if (it->second.type == NET_DEFAULT && !driven.count(it->first))
+            it = nets.erase(it);
+        else
+            ++it;
+    }
+
+    for (std::size_t i = 0; i < result.size(); ++i)
+    {
+        const NormGate &gate = result[i];
+        Node *node = addNode(normFunction(gate.base, gate.inv));
+        node->name = gate.name;
+        node->output_name = result_outs[i];
+        for (const auto &in : gate.ins)
+            node->input_names.push_back(in.second ? inv_nets.at(in.first) : in.first);
+    }
+    construct();
+    sortNodes();
+}
+
 void Circuit::print(bool abc_valid) const {
     std::cout << "module " << name << " (";
     bool first = true;
@@ -601,7 +871,7 @@ Circuit *Circuit::getMiter(Circuit *cone1, Circuit *cone2, Function func)
 }
 
 Circuit::Circuit(const Circuit &cir) :
-    name("top")
+    name(cir.name)
 {
     for (const auto &net : cir.getNets())
         addNet(net.first, net.second.type);
@@ -624,6 +894,7 @@ Circuit *Circuit::getCone(const std::string &po) const
         return nullptr;
 
     Circuit *cone = new Circuit();
+    cone->setName(name);
     cone->addNet(po, NetType::NET_OUTPUT);
 
     std::set<Node *> cache;
@@ -632,6 +903,39 @@ Circuit *Circuit::getCone(const std::string &po) const
     return cone;
 }
 
+Circuit *Circuit::getCone(const std::vector<std::string> &nets, Function func, const std::string &po) const
+{
+    Circuit *cone = new Circuit();
+    cone->setName(name);
+    cone->addNet(po, NetType::NET_OUTPUT);
+
+    Node *root = cone->addNode(func);
+    root->output_name = po;
+
+    std::set<Node *> cache;
+    for (const auto &net : nets)
+    {
+        root->input_names.push_back(net);
+
+        Node *node = getNetInput(net);
+        if (!node || cache.find(node) != cache.end())
+            continue;
+
+        if (node->type == NODE_INPUT)
+        {
+            cache.insert(node);
+            cone->addNet(net, NET_INPUT);
+        }
+        else if (node->type == NODE_DEFAULT)
+        {
+            cone->addNet(net, NET_DEFAULT);
+            getConeRec(cone, node, cache);
+        }
+    }
+    cone->construct();
+    return cone;
+}
+
 void Circuit::getConeRec(Circuit *cone, Node *node, std::set<Node *> &cache) const
 {
     if (cache.find(node) != cache.end())
@@ -77,6 +77,7 @@ public:
     Circuit &operator=(const Circuit &) = delete;
 
     void setName(const std::string &new_name);
+    const std::string &getName() const; ///< Конусы и копии наследуют имя схемы
     Node *addNode(Function function); ///< Добавление узла типа NODE_DEFAULT
     void addNet(const std::string &name, NetType type); ///< Добавление нета
 
@@ -93,6 +94,7 @@ public:
     NetType getNetType(const std::string &name) const; ///< Получение типа нета
 
     Circuit *getCone(const std::string &po) const;
+    Circuit *getCone(const std::vector<std::string> &nets, Function func, const std::string &po) const; ///< Конус нетов nets, объединённых элементом func с выходом po
 
     void setInputValue(const std::string &name, bool value); ///< Установка значения на вход схемы
     void setInputVector(const InVector &in_vec);
@@ -101,6 +103,7 @@ public:
     bool evalOutput(const std::string &po, const InVector &in_vec);
 
     void sortNodes(); ///< Топологическая сортировка узлов схемы
+    void normalize(); ///< Удаление буферов и пар инверторов, перенос инверсий в функции элементов, слияние деревьев однотипных элементов. Имена входов и выходов сохраняются
     void renameNet(const std::string &old_name, const std::string &new_name); ///< Переименование нета для вывода
     void clearRenames(); ///< Очистка переименований
 
@@ -0,0 +1,417 @@
+#include "cone_decomposition.h"
+#include "bit_simulator.h"
+#include <algorithm>
+
+namespace
+{
+
+//compositional reasoning needs every block to take both values
+bool isNonConstant(const Circuit *block)
+{
+    BitSimulator sim(block);
+    Stimulus stimulus(block->getName(), block->getOutputs().front(), "blocks");
+    sim.setWordCount(1);
+    sim.randomizeInputs(stimulus);
+    sim.simulate();
+    Word out_word = sim.getOutputWords()[0];
+    return out_word != 0 && out_word != ~Word(0);
+}
+
+std::size_t countBits(const Words &words)
+{
+    std::size_t count = 0;
+    for (Word word : words)
+        count += __builtin_popcountll(word);
+    return count;
+}
+
+}
+
+ConeDecomposition::ConeDecomposition(Circuit *cone) :
+    cone(cone),
+    root(nullptr),
+    outer(nullptr),
+    decomposable(false),
+    inverted(false),
+    root_function(FUNCTION_AND)
+{
+    if (cone->getOutputs().empty())
+        return;
+
+    root = cone->getNetInput(cone->getOutputs().front()); //only one output in cone
+    if (!root || root->type != NODE_DEFAULT)
+        return;
+
+    if (!computeRootBlocks())
+        computeDominatorBlocks();
+}
+
+ConeDecomposition::~ConeDecomposition()
+{
+    clearBlocks();
+    delete outer;
+}
+
+bool ConeDecomposition::isDecomposable() const
+{
+    return decomposable;
+}
+
+bool ConeDecomposition::isInverted() const
+{
+    return inverted;
+}
+
+Function ConeDecomposition::getRootFunction() const
+{
+    return root_function;
+}
+
+Circuit *ConeDecomposition::getOuterCone() const
+{
+    return outer;
+}
+
+const std::vector<ConeBlock> &ConeDecomposition::getBlocks() const
+{
+    return blocks;
+}
+
+int ConeDecomposition::getBlockIndex(const std::string &pi) const
+{
+    auto it = block_index.find(pi);
+    return it == block_index.end() ? -1 : it->second;
+}
+
+bool ConeDecomposition::computeRootBlocks()
+{
+    Node *top = root;
+    bool top_inverted = false;
+    while ((top->function == FUNCTION_BUF || top->function == FUNCTION_CUT || top->function == FUNCTION_NOT) &&
+           top->input.size() == 1 && top->input.front()->type == NODE_DEFAULT)
+    {
+        if (top->function == FUNCTION_NOT)
+            top_inverted = !top_inverted;
+        top = top->input.front();
+    }
+
+    switch (top->function)
+    {
+    case FUNCTION_AND:
+        root_function = FUNCTION_AND;
+        break;
+    case FUNCTION_NAND:
+        root_function = FUNCTION_AND;
+        top_inverted = !top_inverted;
+        break;
+    case FUNCTION_OR:
+        root_function = FUNCTION_OR;
+        break;
+    case FUNCTION_NOR:
+        root_function = FUNCTION_OR;
+        top_inverted = !top_inverted;
+        break;
+    default:
+        return false;
+    }
+
+    std::vector<Node *> fanins;
+    collectFanins(top, fanins);
+
+    std::vector<std::pair<IOSet, std::vector<std::string>>> groups;
+    for (auto *fanin : fanins)
+    {
+        if (fanin->type == NODE_CONSTANT)
+            return false;
+
+        IOSet support;
+        std::set<Node *> visited;
+        collectSupport(fanin, support, visited);
+
+        //merge all groups sharing inputs with the fanin
+        std::pair<IOSet, std::vector<std::string>> group = {support, {fanin->output_name}};
+        for (std::size_t i = 0; i < groups.size();)
+        {
+            bool shared = std::any_of(groups[i].first.begin(), groups[i].first.end(),
+                                      [&support](const std::string &pi) { return support.find(pi) != support.end(); });
+            if (shared)
+            {
+                group.first.insert(groups[i].first.begin(), groups[i].first.end());
+                group.second.insert(group.second.end(), groups[i].second.begin(), groups[i].second.end());
+                groups.erase(groups.begin() + i);
+            }
+            else
+            {
+                ++i;
+            }
+        }
+        groups.push_back(group);
+    }
+
+    if (groups.size() < 2)
+        return false;
+
+    for (const auto &group : groups)
+        addBlock(group.second, (group.second.size() > 1) ? root_function : FUNCTION_BUF, "", group.first);
+
+    //a constant block fixes the root, so the split tells nothing
+    if (!std::all_of(blocks.begin(), blocks.end(), [](const ConeBlock &block) { return isNonConstant(block.cone); }))
+    {
+        clearBlocks();
+        return false;
+    }
+
+    inverted = top_inverted;
+    decomposable = true;
+    return true;
+}
+
+void ConeDecomposition::computeDominatorBlocks()
+{
+    computeOrder();
+    computeDominators();
+
+    //supports as bit masks over the inputs of the cone, from the inputs towards the output
+    std::vector<std::size_t> input_bit(order.size(), 0);
+    std::size_t num_inputs = 0;
+    for (std::size_t i = 0; i < order.size(); ++i)
+    {
+        if (order[i]->type == NODE_INPUT)
+            input_bit[i] = num_inputs++;
+    }
+    if (num_inputs < 3)
+        return;
+
+    const std::size_t num_words = (num_inputs + 63) / 64;
+    std::vector<Words> support(order.size(), Words(num_words, 0));
+    for (std::size_t i = order.size(); i-- > 0;)
+    {
+        if (order[i]->type == NODE_INPUT)
+        {
+            support[i][input_bit[i] / 64] |= 1ULL << (input_bit[i] % 64);
+            continue;
+        }
+        for (auto *fanin : order[i]->input)
+        {
+            auto it = index.find(fanin);
+            if (it == index.end())
+                continue;
+            for (std::size_t w = 0; w < num_words; ++w)
+                support[i][w] |= support[it->second][w];
+        }
+    }
+
+    //a node heads a block when it dominates every input of its support
+    std::vector<std::size_t> dominated(order.size(), 0);
+    for (std::size_t i = 0; i < order.size(); ++i)
+    {
+        if (order[i]->type != NODE_INPUT)
+            continue;
+        for (std::size_t d = idom[i]; d != 0; d = idom[d])
+            ++dominated[d];
+    }
+
+    std::vector<bool> is_head(order.size(), false);
+    for (std::size_t i = 1; i < order.size(); ++i)
+    {
+        if (order[i]->type != NODE_DEFAULT)
+            continue;
+        std::size_t support_size = countBits(support[i]);
+        is_head[i] = support_size >= 2 && support_size < num_inputs && dominated[i] == support_size;
+    }
+
+    //the topmost head over each input gives maximal blocks, which never overlap
+    std::set<std::size_t> heads;
+    for (std::size_t i = 0; i < order.size(); ++i)
+    {
+        if (order[i]->type != NODE_INPUT)
+            continue;
+        std::size_t head = 0;
+        for (std::size_t d = idom[i]; d != 0; d = idom[d])
+        {
+            if (is_head[d])
+                head = d;
+        }
+        if (head)
+            heads.insert(head);
+    }
+
+    for (std::size_t head : heads)
+    {
+        IOSet inputs;
+        for (std::size_t i = 0; i < order.size(); ++i)
+        {
+            if (order[i]->type == NODE_INPUT && ((support[head][input_bit[i] / 64] >> (input_bit[i] % 64)) & 1))
+                inputs.insert(order[i]->output_name);
+        }
+        addBlock({order[head]->output_name}, FUNCTION_BUF, order[head]->output_name, inputs);
+
+        //a constant block stays inside the outer function
+        if (!isNonConstant(blocks.back().cone))
+        {
+            for (const auto &pi : blocks.back().inputs)
+                block_index.erase(pi);
+            delete blocks.back().cone;
+            blocks.pop_back();
+        }
+    }
+
+    order.clear();
+    index.clear();
+    idom.clear();
+
+    if (blocks.empty())
+        return;
+
+    buildOuterCone();
+    decomposable = true;
+}
+
+void ConeDecomposition::computeOrder()
+{
+    //reverse postorder over fanins: every node follows all of its fanouts
+    std::set<Node *> visited = {root};
+    std::vector<std::pair<Node *, std::size_t>> stack = {{root, 0}};
+    while (!stack.empty())
+    {
+        Node *node = stack.back().first;
+        std::size_t &next = stack.back().second;
+        if (next < node->input.size())
+        {
+            Node *fanin = node->input[next++];
+            if (fanin->type != NODE_CONSTANT && visited.insert(fanin).second)
+                stack.push_back({fanin, 0});
+        }
+        else
+        {
+            order.push_back(node);
+            stack.pop_back();
+        }
+    }
+    std::reverse(order.begin(), order.end());
+    for (std::size_t i = 0; i < order.size(); ++i)
+        index.insert({order[i], i});
+}
+
+void ConeDecomposition::computeDominators()
+{
+    //single pass is exact for DAGs processed from the output towards the inputs
+    idom.assign(order.size(), 0);
+    for (std::size_t i = 1; i < order.size(); ++i)
+    {
+        bool found = false;
+        std::size_t new_idom = 0;
+        for (auto *fanout : order[i]->output)
+        {
+            auto it = index.find(fanout);
+            if (it == index.end())
+                continue;
+            new_idom = found ? intersect(it->second, new_idom) : it->second;
+            found = true;
+        }
+        idom[i] = new_idom;
+    }
+}
+
+std::size_t ConeDecomposition::intersect(std::size_t a, std::size_t b) const
+{
+    while (a != b)
+    {
+        while (a > b)
+            a = idom[a];
+        while (b > a)
+            b = idom[b];
+    }
+    return a;
+}
+
+void ConeDecomposition::buildOuterCone()
+{
+    const auto &po = cone->getOutputs().front();
+    outer = new Circuit();
+    outer->setName(cone->getName());
+    outer->addNet(po, NET_OUTPUT);
+
+    //inputs of the outer function: inputs outside the blocks, then the heads of the blocks
+    std::set<std::string> cut;
+    for (const auto &pi : cone->getInputs())
+    {
+        if (getBlockIndex(pi) < 0)
+            outer->addNet(pi, NET_INPUT);
+    }
+    for (const auto &block : blocks)
+    {
+        outer->addNet(block.net, NET_INPUT);
+        cut.insert(block.net);
+    }
+
+    std::set<Node *> visited = {root};
+    std::vector<Node *> stack = {root};
+    while (!stack.empty())
+    {
+        Node *node = stack.back();
+        stack.pop_back();
+
+        Node *new_node = outer->addNode(node->function);
+        new_node->type = NODE_DEFAULT;
+        new_node->name = node->name;
+        new_node->output_name = node->output_name;
+        new_node->input_names = node->input_names;
+
+        for (auto *i : node->input)
+        {
+            if (i->type != NODE_DEFAULT || cut.find(i->output_name) != cut.end() || !visited.insert(i).second)
+                continue;
+            outer->addNet(i->output_name, NET_DEFAULT);
+            stack.push_back(i);
+        }
+    }
+    outer->construct();
+}
+
+void ConeDecomposition::addBlock(const std::vector<std::string> &nets, Function func, const std::string &net, const IOSet &inputs)
+{
+    const auto &cone_nets = cone->getNets();
+    std::string block_po = cone->getOutputs().front() + "_blk" + std::to_string(blocks.size());
+    while (cone_nets.find(block_po) != cone_nets.end())
+        block_po += "_";
+
+    ConeBlock block = {cone->getCone(nets, func, block_po), net.empty() ? block_po : net, inputs};
+    for (const auto &pi : block.inputs)
+        block_index.insert({pi, static_cast<int>(blocks.size())});
+    blocks.push_back(block);
+}
+
+void ConeDecomposition::clearBlocks()
+{
+    for (const auto &block : blocks)
+        delete block.cone;
+    blocks.clear();
+    block_index.clear();
+}
+
+void ConeDecomposition::collectFanins(Node *node, std::vector<Node *> &fanins) const
+{
+    for (auto *i : node->input)
+    {
+        if (i->type == NODE_DEFAULT && i->function == root_function)
+            collectFanins(i, fanins);
+        else
+            fanins.push_back(i);
+    }
+}
+
+void ConeDecomposition::collectSupport(Node *node, IOSet &support, std::set<Node *> &visited) const
+{
+    if (visited.find(node) != visited.end())
+        return;
+    visited.insert(node);
+
+    if (node->type == NODE_INPUT)
+    {
+        support.insert(node->output_name);
+        return;
+    }
+    for (auto *i : node->input)
+        collectSupport(i, support, visited);
+}
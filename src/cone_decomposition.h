@@ -0,0 +1,58 @@
+#pragma once
+
+#include "circuit.h"
+
+using IOSet = std::set<std::string>;
+
+/// Независимая подфункция конуса
+struct ConeBlock
+{
+    Circuit *cone; ///< Подсхема блока с единственным выходом
+    std::string net; ///< Нет вершины блока; при разбиении по доминаторам - вход внешней функции
+    IOSet inputs; ///< Входы блока, не пересекающиеся с входами остальных блоков
+};
+
+/// Разбиение конуса на блоки с непересекающимися носителями: по группам входов корня AND/OR,
+/// иначе по доминаторам - узлам, через которые проходят все пути от их носителя к выходу
+class ConeDecomposition
+{
+public:
+    ConeDecomposition(Circuit *cone);
+    ~ConeDecomposition();
+
+    ConeDecomposition(const ConeDecomposition &) = delete;
+    ConeDecomposition &operator=(const ConeDecomposition &) = delete;
+
+    bool isDecomposable() const; ///< Найдено разбиение, и ни один блок не константа
+    bool isInverted() const; ///< Корневой элемент инвертирует конъюнкцию/дизъюнкцию блоков
+    Function getRootFunction() const; ///< FUNCTION_AND или FUNCTION_OR при разбиении корня
+    Circuit *getOuterCone() const; ///< Функция от вершин блоков и входов вне блоков при разбиении по доминаторам, иначе nullptr
+
+    const std::vector<ConeBlock> &getBlocks() const;
+    int getBlockIndex(const std::string &pi) const; ///< Номер блока, содержащего вход, или -1
+private:
+    Circuit *cone;
+    Node *root;
+    Circuit *outer;
+
+    bool decomposable, inverted;
+    Function root_function;
+    std::vector<ConeBlock> blocks;
+    std::map<std::string, int> block_index;
+
+    std::vector<Node *> order; ///< Узлы конуса от выхода ко входам: каждый узел после всех своих потребителей
+    std::map<Node *, std::size_t> index;
+    std::vector<std::size_t> idom; ///< Номер непосредственного доминатора в order; у выхода - 0
+
+    bool computeRootBlocks(); ///< Разбиение корня AND/OR на группы входов
+    void computeDominatorBlocks(); ///< Наивысшие доминаторы своих носителей (не менее двух входов, не все входы)
+    void computeOrder();
+    void computeDominators();
+    std::size_t intersect(std::size_t a, std::size_t b) const;
+    void buildOuterCone();
+
+    void addBlock(const std::vector<std::string> &nets, Function func, const std::string &net, const IOSet &inputs);
+    void clearBlocks();
+    void collectFanins(Node *node, std::vector<Node *> &fanins) const;
+    void collectSupport(Node *node, IOSet &support, std::set<Node *> &visited) const;
+};
@@ -0,0 +1,91 @@
+#include "fingerprint.h"
+#include <algorithm>
+
+namespace
+{
+    constexpr Fingerprint input_salt = 0x9e3779b97f4a7c15ULL;
+    constexpr Fingerprint constant_salt = 0xc2b2ae3d27d4eb4fULL;
+    constexpr Fingerprint gate_salt = 0x165667b19e3779f9ULL;
+}
+
+FingerprintCalculator::FingerprintCalculator(Circuit *cir) :
+    cir(cir)
+{}
+
+Fingerprint FingerprintCalculator::getFingerprint(const std::string &po)
+{
+    Node *node = cir->getNetInput(po);
+    if (!node)
+        return 0;
+
+    if (fanout_cnt.empty())
+    {
+        std::set<Node *> visited;
+        for (const auto &out : cir->getOutputs())
+            countFanouts(cir->getNetInput(out), visited);
+    }
+
+    return getFingerprint(node);
+}
+
+void FingerprintCalculator::countFanouts(Node *node, std::set<Node *> &visited)
+{
+    if (!node || visited.find(node) != visited.end())
+        return;
+    visited.insert(node);
+
+    for (auto *i : node->input)
+    {
+        ++fanout_cnt[i];
+        countFanouts(i, visited);
+    }
+}
+
+Fingerprint FingerprintCalculator::getFingerprint(Node *node)
+{
+    auto it = cache.find(node);
+    if (it != cache.end())
+        return it->second;
+
+    Fingerprint result = 0;
+    switch (node->type)
+    {
+    case NODE_INPUT:
+        //input positions are abstracted, only reconvergence (fanout count) is taken into account
+        result = combine(input_salt, fanout_cnt[node]);
+        break;
+    case NODE_CONSTANT:
+        result = combine(constant_salt, node->value ? 1 : 0);
+        break;
+    case NODE_DEFAULT:
+    default:
+        if ((node->function == FUNCTION_BUF || node->function == FUNCTION_CUT) && node->input.size() == 1)
+        {
+            result = getFingerprint(node->input.front());
+            break;
+        }
+
+        std::vector<Fingerprint> fanins;
+        for (auto *i : node->input)
+            fanins.push_back(getFingerprint(i));
+        std::sort(fanins.begin(), fanins.end()); //all gate functions are commutative
+
+        result = combine(gate_salt, static_cast<Fingerprint>(node->function));
+        result = combine(result, fanout_cnt[node]);
+        for (auto fanin : fanins)
+            result = combine(result, fanin);
+        break;
+    }
+
+    cache.insert({node, result});
+    return result;
+}
+
+Fingerprint FingerprintCalculator::combine(Fingerprint seed, Fingerprint value)
+{
+    //splitmix64 finalizer over the accumulated value
+    Fingerprint x = seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
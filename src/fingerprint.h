@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include "circuit.h"
+
+using Fingerprint = std::uint64_t;
+
+/// Структурный хеш конуса, не зависящий от имён нетов, порядка входов коммутативных элементов и перестановки входов схемы
+class FingerprintCalculator
+{
+public:
+    FingerprintCalculator(Circuit *cir);
+
+    Fingerprint getFingerprint(const std::string &po);
+private:
+    Circuit *cir;
+    std::map<Node *, Fingerprint> cache;
+    std::map<Node *, std::size_t> fanout_cnt;
+
+    Fingerprint getFingerprint(Node *node);
+    void countFanouts(Node *node, std::set<Node *> &visited);
+
+    static Fingerprint combine(Fingerprint seed, Fingerprint value);
+};
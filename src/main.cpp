@@ -1,5 +1,7 @@
 #include <iostream>
 #include <chrono>
+#include <random>
+#include <algorithm>
 
 #include "defines.h"
 #include "utils.h"
@@ -8,10 +10,51 @@
 #include "simulator.h"
 #include "verilog.h"
 #include "checker.h"
+#include "bit_simulator.h"
+#include "sim_kernels.h"
+#include "sim_jit.h"
+#include "thread_pool.h"
+#include "stimulus.h"
+#include "simulation_budget.h"
 
 //void printMatching(const Matching& match);
-void printPartition(const POPartition &partition);
+void printPartition(const POPartition &partition, const std::map<std::string, PIPartition> &pi_partitions);
+void printPartitions(const Matcher &matcher);
 void printSymPartition(const SymmetryPartition &partition);
+void runSplit(Matcher &matcher, const Circuit *cir1, const Circuit *cir2, bool functional_support);
+Circuit *getRestructuredCopy(const Circuit *cir, const std::map<std::string, std::string> &pi_map);
+std::size_t countMappingViolations(const Matcher &matcher, const std::map<std::string, std::string> &pi_map);
+
+bool extractFlag(int &argc, char *argv[], const std::string &flag)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        if (flag == argv[i])
+        {
+            for (int j = i; j + 1 < argc; ++j)
+                argv[j] = argv[j + 1];
+            --argc;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool extractOption(int &argc, char *argv[], const std::string &option, std::string &value)
+{
+    for (int i = 1; i + 1 < argc; ++i)
+    {
+        if (option == argv[i])
+        {
+            value = argv[i + 1];
+            for (int j = i; j + 2 < argc; ++j)
+                argv[j] = argv[j + 2];
+            argc -= 2;
+            return true;
+        }
+    }
+    return false;
+}
 
 void printUsage()
 {
@@ -22,12 +65,43 @@ void printUsage()
     std::cout << "\t- miter <in_file.v> <output_name1> <output_name2> <function>" << std::endl;
     std::cout << "\t- cone <in_file.v> <output_name>" << std::endl;
     std::cout << "\t- copy <in_file.v>" << std::endl;
+    std::cout << "\t- norm <in_file.v>" << std::endl;
     std::cout << "\t- sim <in_file.v> <output_name> <num_of_iterations>" << std::endl;
+    std::cout << "\t- split <in_file1.v> <in_file2.v>" << std::endl;
+    std::cout << "\t- simbench <in_file.v> <num_of_words> <num_of_rounds>" << std::endl;
+    std::cout << "\t- selfcheck <in_file.v>" << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << "\t--functional-support\tdrop functionally redundant inputs from output cones (split)" << std::endl;
+    std::cout << "\t--print-partitions\tprint the final output and input partitions (split, selfcheck)" << std::endl;
+    std::cout << "\t--threads <N>\t\tnumber of worker threads, all cores by default" << std::endl;
+    std::cout << "\t--seed <N>\t\tseed of random patterns, taken from the clock by default" << std::endl;
+    std::cout << "\t--truth-table-inputs <N>\tcones with at most N inputs (16 by default, up to 24) are analyzed exactly by their truth tables, 0 disables" << std::endl;
+    std::cout << "\t--spectrum-inputs <N>\tWalsh spectra are computed for cones with at most N inputs (20 by default and at most), 0 disables" << std::endl;
+    std::cout << "\t--patience <N>\t\tstop simulating once candidates have not changed for N patterns (256 by default), 0 keeps fixed budgets" << std::endl;
+    std::cout << "\t--jit <N>\t\tcompile a cone into native code once it has evaluated N gate words, 0 (default) disables" << std::endl;
 }
 
 int main(int argc, char * argv[])
 {
-    srand(time(NULL));
+    bool functional_support = extractFlag(argc, argv, "--functional-support");
+    bool print_partitions = extractFlag(argc, argv, "--print-partitions");
+    std::string num_threads;
+    if (extractOption(argc, argv, "--threads", num_threads))
+        setThreadCount(std::atol(num_threads.c_str()));
+    std::string truth_table_inputs;
+    if (extractOption(argc, argv, "--truth-table-inputs", truth_table_inputs))
+        TruthTable::setMaxInputs(std::atol(truth_table_inputs.c_str()));
+    std::string spectrum_inputs;
+    if (extractOption(argc, argv, "--spectrum-inputs", spectrum_inputs))
+        WalshSpectrum::setMaxInputs(std::atol(spectrum_inputs.c_str()));
+    std::string jit_threshold;
+    if (extractOption(argc, argv, "--jit", jit_threshold))
+        setJitThreshold(std::atol(jit_threshold.c_str()));
+    std::string patience;
+    if (extractOption(argc, argv, "--patience", patience))
+        SimulationBudget::setPatience(std::atol(patience.c_str()));
+    std::string seed;
+    Stimulus::setSeed(extractOption(argc, argv, "--seed", seed) ? std::strtoull(seed.c_str(), nullptr, 10) : time(NULL));
 
     if (argc < 2)
     {
@@ -119,7 +193,7 @@ int main(int argc, char * argv[])
         Circuit *miter = Circuit::getMiter(cone1, cone2, func_map.at(func));
         miter->print();
 
-        checkMiter(miter);
+        printf("Miter check: %s\n", checkMiter(miter) ? "UNSATISFIABLE" : "SATISFIABLE");
 
         delete cir;
         delete cone1;
@@ -163,13 +237,30 @@ int main(int argc, char * argv[])
 
         return OK;
     }
+    else if (cmd == "norm" && argc == 3)
+    {
+        char *in_file = argv[2];
+
+        log("Normalizing circuit %s", in_file);
+
+        Circuit *cir = parse_verilog(FileUtils::load_file(in_file));
+        std::size_t nodes_cnt = cir->getNodes().size();
+
+        cir->normalize();
+        cir->print();
+        log("Nodes: %u -> %u", nodes_cnt, cir->getNodes().size());
+
+        delete cir;
+
+        return OK;
+    }
     else if (cmd == "sim" && argc == 5)
     {
         char *in_file = argv[2];
         const std::string po(argv[3]);
         std::size_t sim_iterations = std::atol(argv[4]);
 
-        log("Starting simulations for output %s (max = %u)", po.c_str(), sim_iterations);
+        log("Starting simulations for output %s (max = %u, seed = %llu)", po.c_str(), sim_iterations, Stimulus::getSeed());
 
         Circuit *cir = parse_verilog(FileUtils::load_file(in_file));
         cir->print();
@@ -202,6 +293,54 @@ int main(int argc, char * argv[])
 
         return OK;
     }
+    else if (cmd == "simbench" && argc == 5)
+    {
+        char *in_file = argv[2];
+        std::size_t num_words = std::atol(argv[3]);
+        std::size_t num_rounds = std::atol(argv[4]);
+
+        Circuit *cir = parse_verilog(FileUtils::load_file(in_file));
+        cir->normalize();
+
+        BitSimulator sim(cir);
+        sim.setWordCount(num_words);
+        Stimulus stimulus("simbench");
+        sim.randomizeInputs(stimulus);
+
+        log("Simulation benchmark for %s: %u nodes, %u patterns per round", in_file, sim.getNodeCount(), num_words * 64);
+        log("Default kernel: %s, threads: %u", getActiveKernel().name, getThreadCount());
+        for (auto type : getSupportedKernels())
+        {
+            sim.setKernel(type);
+            sim.simulate(); //warm-up
+
+            auto start = std::chrono::steady_clock::now();
+            for (std::size_t round = 0; round < num_rounds; ++round)
+                sim.simulate();
+            auto end = std::chrono::steady_clock::now();
+
+            double seconds = std::chrono::duration<double>(end - start).count();
+            log("Kernel %-8s: %.3e patterns/s (%.1fms)", getKernel(type).name,
+                num_rounds * num_words * 64 / seconds, seconds * 1000);
+        }
+
+        if (sim.compileKernel())
+        {
+            sim.simulate(); //warm-up
+
+            auto start = std::chrono::steady_clock::now();
+            for (std::size_t round = 0; round < num_rounds; ++round)
+                sim.simulate();
+            auto end = std::chrono::steady_clock::now();
+
+            double seconds = std::chrono::duration<double>(end - start).count();
+            log("Kernel %-8s: %.3e patterns/s (%.1fms)", "JIT", num_rounds * num_words * 64 / seconds, seconds * 1000);
+        }
+
+        delete cir;
+
+        return OK;
+    }
     else if (cmd == "split" && argc == 4)
     {
         const char *in_file1 = argv[2],
@@ -210,63 +349,48 @@ int main(int argc, char * argv[])
         Circuit *cir1 = parse_verilog(FileUtils::load_file(in_file1)),
                 *cir2 = parse_verilog(FileUtils::load_file(in_file2));
 
-        Matcher matcher(cir1, cir2);
+        std::size_t nodes_cnt1 = cir1->getNodes().size(),
+                    nodes_cnt2 = cir2->getNodes().size();
+        cir1->normalize();
+        cir2->normalize();
+        log("Normalized nodes: %u -> %u, %u -> %u", nodes_cnt1, cir1->getNodes().size(), nodes_cnt2, cir2->getNodes().size());
 
-        constexpr std::size_t max_it = 1000;
-
-        double init_matchings_cnt = permCount(cir1->getInputs().size(), cir2->getInputs().size()) *
-                                                combCount(cir1->getOutputs().size(), cir2->getOutputs().size());
-        log("output matches: %e", combCount(cir1->getOutputs().size(), cir2->getOutputs().size()));
-        log("input matches: %e", permCount(cir1->getInputs().size(), cir2->getInputs().size()));
-        log("Initial possible matchings: %e", init_matchings_cnt);
-
-        std::chrono::time_point<std::chrono::system_clock> start, end;
-        std::chrono::milliseconds elapsed;
-        log("Splitting by support...");
-        start = std::chrono::system_clock::now();
-        matcher.splitBySupport();
-        end = std::chrono::system_clock::now();
-        elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-        log("Elapsed %dms", elapsed.count());
-        log("Possible matchings: %e", matcher.calculatePossibleMatchings());
-
-        log("Splitting by unateness...");
-        start = std::chrono::system_clock::now();
-        matcher.splitByUnateness();
-        end = std::chrono::system_clock::now();
-        elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-        log("Elapsed %dms", elapsed.count());
-        log("Possible matchings: %e", matcher.calculatePossibleMatchings());
-
-        log("Splitting by symmetry...");
-        start = std::chrono::system_clock::now();
-        matcher.splitBySymmetry();
-        end = std::chrono::system_clock::now();
-        elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-        log("Elapsed %dms", elapsed.count());
-        log("Possible matchings: %e", matcher.calculatePossibleMatchings());
-
-        log("Splitting by simulation type 1 (max_it = %u)...", max_it);
-        start = std::chrono::system_clock::now();
-        matcher.splitBySimType1(max_it);
-        end = std::chrono::system_clock::now();
-        elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-        log("Elapsed %dms", elapsed.count());
-        log("Possible matchings: %e", matcher.calculatePossibleMatchings());
-
-        log("Splitting by simulation type 2 (max_it = %u)...", max_it);
-        start = std::chrono::system_clock::now();
-        matcher.splitBySimType2(max_it);
-        end = std::chrono::system_clock::now();
-        elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-        log("Elapsed %dms", elapsed.count());
-        log("Possible matchings: %e", matcher.calculatePossibleMatchings());
-
-//        auto partitions = matcher.getPOPartitions();
-//        printPartition(partitions.first);
-//        printPartition(partitions.second);
+        Matcher matcher(cir1, cir2);
+        runSplit(matcher, cir1, cir2, functional_support);
+        if (print_partitions)
+            printPartitions(matcher);
         return OK;
     }
+    else if (cmd == "selfcheck" && argc == 3)
+    {
+        const char *in_file = argv[2];
+
+        Circuit *cir1 = parse_verilog(FileUtils::load_file(in_file));
+
+        //the known matching shuffles the inputs by the seed and keeps the outputs
+        std::vector<std::string> images = cir1->getInputs();
+        std::mt19937_64 generator(Stimulus::getSeed());
+        std::shuffle(images.begin(), images.end(), generator);
+        std::map<std::string, std::string> pi_map;
+        for (std::size_t i = 0; i < images.size(); ++i)
+            pi_map[cir1->getInputs()[i]] = images[i];
+
+        Circuit *cir2 = getRestructuredCopy(cir1, pi_map);
+        std::size_t nodes_cnt1 = cir1->getNodes().size(),
+                    nodes_cnt2 = cir2->getNodes().size();
+        cir1->normalize();
+        cir2->normalize();
+        log("Normalized nodes: %u -> %u, restructured %u -> %u", nodes_cnt1, cir1->getNodes().size(), nodes_cnt2, cir2->getNodes().size());
+
+        Matcher matcher(cir1, cir2);
+        runSplit(matcher, cir1, cir2, functional_support);
+        if (print_partitions)
+            printPartitions(matcher);
+
+        std::size_t violations = countMappingViolations(matcher, pi_map);
+        log("Self-check %s: %u ports lost their known images", violations ? "FAILED" : "passed", violations);
+        return violations ? FAIL : OK;
+    }
     else
     {
         makeAssertion("Wrong command or number of arguments");
@@ -381,7 +505,7 @@ void printSymPartition(const SymmetryPartition &partition)
         log("Symmetry: %s, inputs: %s", symToStr(cluster.first).c_str(), IOSetToStr(cluster.second).c_str());
 }
 
-void printPartition(const POPartition &partition)
+void printPartition(const POPartition &partition, const std::map<std::string, PIPartition> &pi_partitions)
 {
     std::size_t i = 0;
     for (const auto &cluster : partition)
@@ -389,9 +513,234 @@ void printPartition(const POPartition &partition)
         log("Cluster %u:", i);
         log("Outputs: %s", IOSetToStr(cluster.second).c_str());
         log("Support size: %u", cluster.first.support_size);
+        if (cluster.first.invariant_key)
+            log("Invariant key: %016llx", static_cast<unsigned long long>(cluster.first.invariant_key));
+        if (cluster.first.canonical_form)
+            log("Canonical form: %016llx", static_cast<unsigned long long>(cluster.first.canonical_form));
         log("Input partition: %s", PISignMaskToStr(cluster.first.input_signatures).c_str());
+        for (const auto &po : cluster.second)
+        {
+            std::string inputs;
+            for (const auto &pi_cluster : pi_partitions.at(po))
+                inputs += (inputs.empty() ? "{" : " {") + IOSetToStr(pi_cluster.second) + "}";
+            log("Inputs of %s: %s", po.c_str(), inputs.c_str());
+        }
         log("---------");
         ++i;
     }
 }
 
+void printPartitions(const Matcher &matcher)
+{
+    const auto po_partitions = matcher.getPOPartitions();
+    const auto pi_partitions = matcher.getPIPartitions();
+    log("Partitions of the first circuit:");
+    printPartition(po_partitions.first, pi_partitions.first);
+    log("Partitions of the second circuit:");
+    printPartition(po_partitions.second, pi_partitions.second);
+}
+
+void runSplit(Matcher &matcher, const Circuit *cir1, const Circuit *cir2, bool functional_support)
+{
+    log("Threads: %u, seed: %llu, truth tables up to %u inputs, patience: %u patterns",
+        getThreadCount(), Stimulus::getSeed(), TruthTable::getMaxInputs(), SimulationBudget::getPatience());
+
+    constexpr std::size_t max_it = 1000;
+
+    double init_matchings_cnt = permCount(cir1->getInputs().size(), cir2->getInputs().size()) *
+                                            combCount(cir1->getOutputs().size(), cir2->getOutputs().size());
+    log("output matches: %e", combCount(cir1->getOutputs().size(), cir2->getOutputs().size()));
+    log("input matches: %e", permCount(cir1->getInputs().size(), cir2->getInputs().size()));
+    log("Initial possible matchings: %e", init_matchings_cnt);
+
+    std::chrono::time_point<std::chrono::system_clock> start, end;
+    std::chrono::milliseconds elapsed;
+    log("Splitting by %s support...", functional_support ? "functional" : "structural");
+    start = std::chrono::system_clock::now();
+    matcher.splitBySupport(functional_support ? SupportMode::Functional : SupportMode::Structural);
+    end = std::chrono::system_clock::now();
+    elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    log("Elapsed %dms", elapsed.count());
+    log("Possible matchings: %e", matcher.calculatePossibleMatchings());
+
+    log("Splitting by structural fingerprints...");
+    start = std::chrono::system_clock::now();
+    matcher.splitByFingerprint();
+    end = std::chrono::system_clock::now();
+    elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    log("Elapsed %dms", elapsed.count());
+    log("Possible matchings: %e", matcher.calculatePossibleMatchings());
+
+    log("Splitting by canonical forms of truth tables...");
+    start = std::chrono::system_clock::now();
+    matcher.splitByCanonicalForm();
+    end = std::chrono::system_clock::now();
+    elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    log("Elapsed %dms", elapsed.count());
+    log("Possible matchings: %e", matcher.calculatePossibleMatchings());
+
+    log("Splitting by Hamming weight classes...");
+    start = std::chrono::system_clock::now();
+    matcher.splitByWeightProfile();
+    end = std::chrono::system_clock::now();
+    elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    log("Elapsed %dms", elapsed.count());
+    log("Possible matchings: %e", matcher.calculatePossibleMatchings());
+
+    log("Splitting by unateness...");
+    start = std::chrono::system_clock::now();
+    matcher.splitByUnateness();
+    end = std::chrono::system_clock::now();
+    elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    log("Elapsed %dms", elapsed.count());
+    log("Possible matchings: %e", matcher.calculatePossibleMatchings());
+
+    log("Splitting by symmetry...");
+    start = std::chrono::system_clock::now();
+    matcher.splitBySymmetry();
+    end = std::chrono::system_clock::now();
+    elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    log("Elapsed %dms", elapsed.count());
+    log("Possible matchings: %e", matcher.calculatePossibleMatchings());
+
+    log("Splitting by Walsh spectra (cones up to %u inputs)...", WalshSpectrum::getMaxInputs());
+    start = std::chrono::system_clock::now();
+    matcher.splitBySpectrum();
+    end = std::chrono::system_clock::now();
+    elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    log("Elapsed %dms", elapsed.count());
+    log("Possible matchings: %e", matcher.calculatePossibleMatchings());
+
+    constexpr std::size_t influence_patterns = 16384;
+    log("Splitting by input influence (max %u patterns)...", influence_patterns);
+    start = std::chrono::system_clock::now();
+    matcher.splitByInfluence(influence_patterns);
+    end = std::chrono::system_clock::now();
+    elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    log("Elapsed %dms", elapsed.count());
+    log("Possible matchings: %e", matcher.calculatePossibleMatchings());
+
+    log("Splitting by simulation type 1 (max_it = %u)...", max_it);
+    start = std::chrono::system_clock::now();
+    matcher.splitBySimType1(max_it);
+    end = std::chrono::system_clock::now();
+    elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    log("Elapsed %dms", elapsed.count());
+    log("Possible matchings: %e", matcher.calculatePossibleMatchings());
+
+    log("Splitting by simulation type 2 (max_it = %u)...", max_it);
+    start = std::chrono::system_clock::now();
+    matcher.splitBySimType2(max_it);
+    end = std::chrono::system_clock::now();
+    elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    log("Elapsed %dms", elapsed.count());
+    log("Possible matchings: %e", matcher.calculatePossibleMatchings());
+}
+
+Circuit *getRestructuredCopy(const Circuit *cir, const std::map<std::string, std::string> &pi_map)
+{
+    auto rename = [&pi_map](const std::string &net)
+    {
+        auto it = pi_map.find(net);
+        return it == pi_map.end() ? net : it->second;
+    };
+
+    Circuit *copy = new Circuit();
+    copy->setName(cir->getName());
+    const auto &inputs = cir->getInputs();
+    for (auto it = inputs.rbegin(); it != inputs.rend(); ++it)
+        copy->addNet(rename(*it), NET_INPUT);
+    for (const auto &po : cir->getOutputs())
+        copy->addNet(po, NET_OUTPUT);
+    for (const auto &net : cir->getNets())
+    {
+        if (net.second.type == NET_DEFAULT)
+            copy->addNet(net.first, NET_DEFAULT);
+    }
+
+    auto addGate = [copy](Function function, const std::string &output_name, const std::vector<std::string> &input_names)
+    {
+        Node *node = copy->addNode(function);
+        node->output_name = output_name;
+        node->input_names = input_names;
+    };
+    std::size_t num_wires = 0;
+    auto addInverter = [&](const std::string &net)
+    {
+        //such names cannot clash with verilog identifiers
+        const std::string wire = "%restructured_" + std::to_string(num_wires++) + "%";
+        copy->addNet(wire, NET_DEFAULT);
+        addGate(FUNCTION_NOT, wire, {net});
+        return wire;
+    };
+
+    //De Morgan duals over inverted fanins, XOR and XNOR swap with a single inverted fanin
+    const std::map<Function, Function> duals =
+    {
+        {FUNCTION_AND , FUNCTION_NOR },
+        {FUNCTION_NAND, FUNCTION_OR  },
+        {FUNCTION_OR  , FUNCTION_NAND},
+        {FUNCTION_NOR , FUNCTION_AND },
+        {FUNCTION_XOR , FUNCTION_XNOR},
+        {FUNCTION_XNOR, FUNCTION_XOR },
+    };
+    for (const auto *node : cir->getNodes())
+    {
+        if (node->type != NODE_DEFAULT)
+            continue;
+
+        std::vector<std::string> fanins;
+        for (auto it = node->input_names.rbegin(); it != node->input_names.rend(); ++it)
+            fanins.push_back(rename(*it));
+
+        auto dual = duals.find(node->function);
+        if (dual == duals.end() || fanins.empty())
+        {
+            addGate(node->function, node->output_name, fanins);
+            continue;
+        }
+        const bool is_xor = node->function == FUNCTION_XOR || node->function == FUNCTION_XNOR;
+        for (std::size_t i = 0; i < (is_xor ? 1 : fanins.size()); ++i)
+            fanins[i] = addInverter(fanins[i]);
+        addGate(dual->second, node->output_name, fanins);
+    }
+
+    copy->construct();
+    return copy;
+}
+
+std::size_t countMappingViolations(const Matcher &matcher, const std::map<std::string, std::string> &pi_map)
+{
+    //outputs keep their names, inputs of each output must stay in the clusters of their images
+    const auto po_partitions = matcher.getPOPartitions();
+    const auto pi_partitions = matcher.getPIPartitions();
+    std::size_t violations = 0;
+    for (const auto &cluster : po_partitions.first)
+    {
+        auto images = po_partitions.second.find(cluster.first);
+        for (const auto &po : cluster.second)
+        {
+            if (images == po_partitions.second.end() || !images->second.count(po))
+            {
+                log("Output %s is separated from its image", po.c_str());
+                ++violations;
+                continue;
+            }
+
+            const auto &pi_partition1 = pi_partitions.first.at(po),
+                       &pi_partition2 = pi_partitions.second.at(po);
+            for (std::size_t i = 0; i < pi_partition1.size(); ++i)
+            {
+                for (const auto &pi : pi_partition1[i].second)
+                {
+                    if (i >= pi_partition2.size() || !pi_partition2[i].second.count(pi_map.at(pi)))
+                    {
+                        log("Input %s of output %s is separated from its image %s", pi.c_str(), po.c_str(), pi_map.at(pi).c_str());
+                        ++violations;
+                    }
+                }
+            }
+        }
+    }
+    return violations;
+}
@@ -1,13 +1,66 @@
 #include "matcher.h"
 #include "utils.h"
+#include "support_calculator.h"
+#include "thread_pool.h"
+#include <algorithm>
+
+namespace
+{
+    //cones of the unresolved clusters are independent and simulated concurrently
+    template <typename Result, typename Func>
+    std::map<std::string, Result> simulateCones(const POPartition &po_partition, Func func)
+    {
+        std::vector<std::string> pos;
+        for (const auto &cluster : po_partition)
+        {
+            if (!cluster.first.isResolved())
+                pos.insert(pos.end(), cluster.second.begin(), cluster.second.end());
+        }
+
+        std::vector<Result> results(pos.size());
+        parallelFor(pos.size(), [&](std::size_t i) { results[i] = func(pos[i]); });
+
+        std::map<std::string, Result> result_map;
+        for (std::size_t i = 0; i < pos.size(); ++i)
+            result_map.insert({pos[i], std::move(results[i])});
+        return result_map;
+    }
+
+    std::uint64_t mix(std::uint64_t x)
+    {
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+    }
+
+    //variables at equal canonical positions correspond to each other
+    std::vector<std::size_t> getVarMap(const CanonicalForm &from, const CanonicalForm &to)
+    {
+        std::vector<std::size_t> var_map(from.perm.size());
+        for (std::size_t k = 0; k < from.perm.size(); ++k)
+            var_map[from.perm[k]] = to.perm[k];
+        return var_map;
+    }
+}
+
+constexpr std::size_t Matcher::influence_words;
+constexpr std::size_t Matcher::max_pair_words;
 
 Matcher::Matcher(Circuit *cir1, Circuit *cir2) :
-    cir1(cir1), cir2(cir2)
+    cir1(cir1), cir2(cir2),
+    stimulus("matcher")
 {
+    //the cones are renamed so that the random streams of the two circuits differ even for equal output names
     for (const auto &po : cir1->getOutputs())
+    {
         cones1.insert({po, cir1->getCone(po)});
+        cones1.at(po)->setName("cir1");
+    }
     for (const auto &po : cir2->getOutputs())
+    {
         cones2.insert({po, cir2->getCone(po)});
+        cones2.at(po)->setName("cir2");
+    }
 
     cir1_po_partition = { {POSignature(cir1), IOSet(cir1->getOutputs().begin(), cir1->getOutputs().end())} };
     cir2_po_partition = { {POSignature(cir1), IOSet(cir2->getOutputs().begin(), cir2->getOutputs().end())} };
@@ -24,12 +77,188 @@ Matcher::~Matcher()
         delete it.second;
     for (const auto &it : cones2)
         delete it.second;
+    for (const auto &it : cone_simulators)
+        delete it.second;
+    for (const auto &it : pattern_pools)
+        delete it.second;
 }
 
-Matcher &Matcher::splitBySupport()
+Matcher &Matcher::splitBySupport(SupportMode mode)
 {
-    splitBySupport(cir1_po_partition, cir1_pi_partitions, cir1, cones1);
-    splitBySupport(cir2_po_partition, cir2_pi_partitions, cir2, cones2);
+    splitBySupport(cir1_po_partition, cir1_pi_partitions, cir1, cones1, mode);
+    splitBySupport(cir2_po_partition, cir2_pi_partitions, cir2, cones2, mode);
+    return *this;
+}
+
+Matcher &Matcher::splitByFingerprint()
+{
+    splitByFingerprint(cir1_po_partition, cir2_po_partition);
+    return *this;
+}
+
+Matcher &Matcher::splitByCanonicalForm()
+{
+    auto partition_copy1 = cir1_po_partition;
+
+    for (const auto &cluster : partition_copy1)
+    {
+        if (cluster.first.isResolved() || (cir2_po_partition.find(cluster.first) == cir2_po_partition.end()))
+            continue;
+
+        std::vector<std::pair<std::string, const Cones *>> pos;
+        for (const auto &po : cluster.second)
+            pos.push_back({po, &cones1});
+        for (const auto &po : cir2_po_partition.at(cluster.first))
+            pos.push_back({po, &cones2});
+
+        std::vector<TruthTable *> tables(pos.size(), nullptr);
+        std::vector<CanonicalForm> forms(pos.size());
+        parallelFor(pos.size(), [&](std::size_t i)
+        {
+            Circuit *cone = pos[i].second->at(pos[i].first);
+            if (!TruthTable::isApplicable(cone) || cone->getInputs().empty() ||
+                cone->getInputs().size() > TruthTable::max_canonical_inputs)
+                return;
+            tables[i] = new TruthTable(cone);
+            forms[i] = tables[i]->getCanonicalForm();
+        });
+
+        std::map<std::uint64_t, std::pair<std::vector<std::size_t>, std::vector<std::size_t>>> groups;
+        for (std::size_t i = 0; i < pos.size(); ++i)
+        {
+            if (!tables[i])
+                continue;
+            auto &group = groups[forms[i].getKey()];
+            (pos[i].second == &cones1 ? group.first : group.second).push_back(i);
+        }
+
+        for (const auto &group : groups)
+        {
+            const auto &inds1 = group.second.first, &inds2 = group.second.second;
+            if (inds1.empty() || inds1.size() != inds2.size())
+                continue;
+
+            //the form is only semi-canonical, so every output is checked against the first one under the derived permutation
+            const std::size_t rep = inds1.front();
+            bool verified = true;
+            for (const auto *inds : {&inds1, &inds2})
+            {
+                for (auto ind : *inds)
+                    verified = verified && tables[rep]->isPermutationOf(*tables[ind], getVarMap(forms[rep], forms[ind]));
+            }
+            if (!verified)
+                continue;
+
+            //the verified permutation is one of many when the function has automorphisms, so positions are only grouped
+            //by signatures that automorphisms preserve: every orbit stays inside one cluster
+            const WalshSpectrum spectrum(*tables[rep]);
+            std::vector<std::uint64_t> position_keys;
+            std::map<std::uint64_t, std::size_t> key_clusters;
+            for (auto var : forms[rep].perm)
+            {
+                std::uint64_t key = mix(spectrum.getInputSignature(var) ^
+                                        (tables[rep]->isPosUnate(var) ? 1 : 0) ^ (tables[rep]->isNegUnate(var) ? 2 : 0));
+                key = key ? key : 1;
+                position_keys.push_back(key);
+                key_clusters.insert({key, key_clusters.size()});
+            }
+
+            //clusters are ordered by their first canonical position, so equal indices of the input partitions are matched
+            auto resolve = [&](std::size_t ind, POPartition &po_partition, std::map<std::string, PIPartition> &pi_partitions)
+            {
+                const auto &po = pos[ind].first;
+                PIPartition pi_partition(key_clusters.size());
+                for (std::size_t k = 0; k < forms[ind].perm.size(); ++k)
+                {
+                    auto &pi_cluster = pi_partition[key_clusters.at(position_keys[k])];
+                    pi_cluster.first.spectrum = position_keys[k];
+                    pi_cluster.second.insert(tables[ind]->getInputName(forms[ind].perm[k]));
+                }
+
+                POSignature new_sign(pi_partition);
+                new_sign.canonical_form = group.first;
+                po_partition.at(cluster.first).erase(po);
+                po_partition[new_sign].insert(po);
+                pi_partitions.at(po) = pi_partition;
+            };
+            for (auto ind : inds1)
+                resolve(ind, cir1_po_partition, cir1_pi_partitions);
+            for (auto ind : inds2)
+                resolve(ind, cir2_po_partition, cir2_pi_partitions);
+        }
+
+        if (cir1_po_partition.at(cluster.first).empty())
+            cir1_po_partition.erase(cluster.first);
+        if (cir2_po_partition.at(cluster.first).empty())
+            cir2_po_partition.erase(cluster.first);
+
+        for (auto *table : tables)
+            delete table;
+    }
+    return *this;
+}
+
+Matcher &Matcher::splitByWeightProfile()
+{
+    auto partition_copy1 = cir1_po_partition;
+
+    for (const auto &cluster : partition_copy1)
+    {
+        if (cluster.first.isResolved() || (cir2_po_partition.find(cluster.first) == cir2_po_partition.end()))
+            continue;
+
+        std::vector<std::pair<std::string, const Cones *>> pos;
+        for (const auto &po : cluster.second)
+            pos.push_back({po, &cones1});
+        for (const auto &po : cir2_po_partition.at(cluster.first))
+            pos.push_back({po, &cones2});
+
+        std::vector<WeightProfile *> profiles(pos.size(), nullptr);
+        parallelFor(pos.size(), [&](std::size_t i) { profiles[i] = new WeightProfile(pos[i].second->at(pos[i].first)); });
+
+        //a class near a bucket boundary for any output could be split by sampling noise alone, so it is ignored by the whole cluster
+        std::vector<bool> used(WeightProfile::num_classes, true);
+        for (const auto *profile : profiles)
+        {
+            for (std::size_t cls = 0; cls < WeightProfile::num_classes; ++cls)
+                used[cls] = used[cls] && !profile->isAmbiguous(cls);
+        }
+
+        std::vector<std::uint64_t> keys(pos.size());
+        std::map<std::uint64_t, std::pair<std::size_t, std::size_t>> key_counts;
+        bool all_exact = true;
+        for (std::size_t i = 0; i < pos.size(); ++i)
+        {
+            std::uint64_t key = mix(cluster.first.invariant_key + 0x9E3779B97F4A7C15ULL);
+            for (std::size_t cls = 0; cls < WeightProfile::num_classes; ++cls)
+                key = mix(key ^ (used[cls] ? profiles[i]->getClassKey(cls) + 1 : 0));
+            keys[i] = key ? key : 1;
+            auto &counts = key_counts[keys[i]];
+            ++(pos[i].second == &cones1 ? counts.first : counts.second);
+            all_exact = all_exact && profiles[i]->isExact();
+            delete profiles[i];
+        }
+
+        //estimates are sampled separately in each circuit, so a split that does not divide both circuits alike
+        //is more likely noise than a difference and is only a hint that is not applied
+        if (!all_exact && std::any_of(key_counts.begin(), key_counts.end(),
+                                      [](const decltype(key_counts)::value_type &it) { return it.second.first != it.second.second; }))
+            continue;
+
+        for (std::size_t i = 0; i < pos.size(); ++i)
+        {
+            POSignature new_sign = cluster.first;
+            new_sign.invariant_key = keys[i];
+            auto &po_partition = pos[i].second == &cones1 ? cir1_po_partition : cir2_po_partition;
+            po_partition.at(cluster.first).erase(pos[i].first);
+            po_partition[new_sign].insert(pos[i].first);
+        }
+
+        if (cir1_po_partition.at(cluster.first).empty())
+            cir1_po_partition.erase(cluster.first);
+        if (cir2_po_partition.at(cluster.first).empty())
+            cir2_po_partition.erase(cluster.first);
+    }
     return *this;
 }
 
@@ -47,24 +276,152 @@ Matcher &Matcher::splitBySymmetry()
     return *this;
 }
 
+Matcher &Matcher::splitBySpectrum()
+{
+    splitBySpectrum(cir1_po_partition, cir1_pi_partitions, cones1);
+    splitBySpectrum(cir2_po_partition, cir2_pi_partitions, cones2);
+    return *this;
+}
+
+Matcher &Matcher::splitByInfluence(std::size_t max_patterns)
+{
+    for (SimulationBudget budget(max_patterns, influence_words * 64); !budget.isExhausted(); )
+        budget.update(splitByInfluence());
+    return *this;
+}
+
 Matcher &Matcher::splitBySimType1(std::size_t max_it)
 {
-    for (std::size_t it = 0; it < max_it; ++it)
-    {
-        if (splitBySimType1())
-            it = 0;
-    }
+    //every split restarts the budget, the phase ends after max_it (or patience) rounds without a split
+    for (SimulationBudget budget(max_it, 1, BudgetMode::SinceProgress); !budget.isExhausted(); )
+        budget.update(splitBySimType1());
     return *this;
 }
 
 Matcher &Matcher::splitBySimType2(std::size_t max_it)
 {
-    for (std::size_t it = 0; it < max_it; ++it)
+    //every split restarts the budget, the phase ends after max_it (or patience) rounds without a split
+    for (SimulationBudget budget(max_it, 1, BudgetMode::SinceProgress); !budget.isExhausted(); )
+        budget.update(splitBySimType2());
+    return *this;
+}
+
+bool Matcher::splitByInfluence()
+{
+    POPartition new_partition1, new_partition2;
+    bool split = false;
+
+    for (const auto &cluster : cir1_po_partition)
+    {
+        auto it2 = cir2_po_partition.find(cluster.first);
+        if (cluster.first.isResolved() || it2 == cir2_po_partition.end())
+        {
+            new_partition1.insert(cluster);
+            continue;
+        }
+
+        //inputs of one cluster share their words, so equal clusters of both circuits see the same patterns
+        std::vector<Words> cluster_words(cluster.first.input_signatures.size(), Words(influence_words));
+        for (auto &words : cluster_words)
+        {
+            for (auto &word : words)
+                word = stimulus.nextWord();
+        }
+
+        std::vector<std::pair<std::string, bool>> pos;
+        for (const auto &po : cluster.second)
+            pos.push_back({po, true});
+        for (const auto &po : it2->second)
+            pos.push_back({po, false});
+
+        std::vector<std::vector<std::uint64_t>> influence(pos.size());
+        for (const auto &it : pos)
+        {
+            const Circuit *cone = (it.second ? cones1 : cones2).at(it.first);
+            if (cone_simulators.find(cone) == cone_simulators.end())
+                cone_simulators.insert({cone, new BitSimulator(cone)});
+        }
+        parallelFor(pos.size(), [&](std::size_t i)
+        {
+            const auto &po = pos[i].first;
+            const bool first = pos[i].second;
+            calculateInfluence((first ? cones1 : cones2).at(po), (first ? cir1_pi_partitions : cir2_pi_partitions).at(po),
+                               cluster_words, influence[i]);
+        });
+
+        for (std::size_t i = 0; i < pos.size(); ++i)
+        {
+            const auto &po = pos[i].first;
+            PIPartition &pi_partition = (pos[i].second ? cir1_pi_partitions : cir2_pi_partitions).at(po);
+            PIPartition new_pi_partition;
+            std::size_t j = 0;
+            for (const auto &pi_cluster : pi_partition)
+            {
+                std::map<std::uint64_t, IOSet> influence_map;
+                for (const auto &pi : pi_cluster.second)
+                    influence_map[influence[i][j++]].insert(pi);
+                for (const auto &it : influence_map)
+                {
+                    PISignature new_pi_sign = pi_cluster.first;
+                    new_pi_sign.influence = mix(pi_cluster.first.influence ^ it.first);
+                    new_pi_partition.push_back({new_pi_sign, it.second});
+                }
+                split = split || influence_map.size() > 1;
+            }
+            pi_partition = new_pi_partition;
+            (pos[i].second ? new_partition1 : new_partition2)[POSignature(new_pi_partition, cluster.first.invariant_key)].insert(po);
+        }
+    }
+    for (const auto &cluster : cir2_po_partition)
     {
-        if (splitBySimType2())
-            it = 0;
+        if (cluster.first.isResolved() || cir1_po_partition.find(cluster.first) == cir1_po_partition.end())
+            new_partition2.insert(cluster);
+    }
+
+    cir1_po_partition = new_partition1;
+    cir2_po_partition = new_partition2;
+    return split;
+}
+
+void Matcher::calculateInfluence(const Circuit *cone, const PIPartition &pi_partition, const std::vector<Words> &cluster_words,
+                                 std::vector<std::uint64_t> &influence)
+{
+    BitSimulator &sim = *cone_simulators.at(cone);
+    if (sim.getWordCount() != influence_words)
+        sim.setWordCount(influence_words);
+
+    std::vector<std::pair<std::size_t, const Word *>> inputs;
+    for (std::size_t i = 0; i < pi_partition.size(); ++i)
+    {
+        for (const auto &pi : pi_partition[i].second)
+        {
+            inputs.push_back({sim.getInputIndex(pi), cluster_words[i].data()});
+            if (inputs.back().first != BitSimulator::npos)
+                sim.setInputWords(inputs.back().first, cluster_words[i]);
+        }
+    }
+    sim.simulate();
+
+    //the flipped response gives both cofactors: f|pi=1 takes the base output where pi is 1 and the flipped one elsewhere
+    const Word *out = sim.getOutputWords();
+    Words base(out, out + influence_words);
+    influence.assign(inputs.size(), 0);
+    for (std::size_t k = 0; k < inputs.size(); ++k)
+    {
+        if (inputs[k].first == BitSimulator::npos)
+            continue;
+        sim.flipInputs({inputs[k].first});
+        const Word *value = inputs[k].second, *flipped = sim.getOutputWords();
+        std::uint64_t flips = 0, pos_weight = 0, neg_weight = 0;
+        for (std::size_t w = 0; w < influence_words; ++w)
+        {
+            flips += __builtin_popcountll(base[w] ^ flipped[w]);
+            pos_weight += __builtin_popcountll((value[w] & base[w]) | (~value[w] & flipped[w]));
+            neg_weight += __builtin_popcountll((~value[w] & base[w]) | (value[w] & flipped[w]));
+        }
+        sim.restoreFlips();
+        influence[k] = mix(mix(mix(flips) ^ pos_weight) ^ neg_weight);
     }
-    return *this;
 }
 
 bool Matcher::splitBySimType1()
@@ -76,7 +433,7 @@ bool Matcher::splitBySimType1()
 
     for (const auto &cluster : cir1_po_partition)
     {
-        if (split || (cir2_po_partition.find(cluster.first) == cir2_po_partition.end()))
+        if (split || cluster.first.isResolved() || (cir2_po_partition.find(cluster.first) == cir2_po_partition.end()))
             continue;
 
         POSignature sign = cluster.first;
@@ -88,7 +445,7 @@ bool Matcher::splitBySimType1()
             std::vector<bool> boolVec;
             for (std::size_t j = 0; j < sign.input_signatures.size(); ++j)
             {
-                bool value = (rand() % 2) == 0;
+                bool value = stimulus.nextBool();
                 for (std::size_t k = 0; k < sign.input_signatures[j].first; ++k)
                     boolVec.push_back(value);
             }
@@ -96,13 +453,13 @@ bool Matcher::splitBySimType1()
             for (const auto &po : cir1_po_partition.at(sign))
             {
                 auto result = splitBySimType1(po, cones1, cir1_pi_partitions.at(po), boolVec, i);
-                new_partition1[POSignature(cir1_pi_partitions.at(po))].insert(po);
+                new_partition1[POSignature(cir1_pi_partitions.at(po), sign.invariant_key)].insert(po);
                 split = split || result;
             }
             for (const auto &po : cir2_po_partition.at(sign))
             {
                 auto result = splitBySimType1(po, cones2, cir2_pi_partitions.at(po), boolVec, i);
-                new_partition2[POSignature(cir2_pi_partitions.at(po))].insert(po);
+                new_partition2[POSignature(cir2_pi_partitions.at(po), sign.invariant_key)].insert(po);
                 split = split || result;
             }
             if (split)
@@ -123,7 +480,7 @@ bool Matcher::splitBySimType2()
 
     for (const auto &cluster : cir1_po_partition)
     {
-        if (split || (cir2_po_partition.find(cluster.first) == cir2_po_partition.end()))
+        if (split || cluster.first.isResolved() || (cir2_po_partition.find(cluster.first) == cir2_po_partition.end()))
             continue;
 
         POSignature sign = cluster.first;
@@ -135,7 +492,7 @@ bool Matcher::splitBySimType2()
             std::vector<bool> boolVec;
             for (std::size_t j = 0; j < sign.input_signatures.size(); ++j)
             {
-                bool value = (rand() % 2) == 0;
+                bool value = stimulus.nextBool();
                 for (std::size_t k = 0; k < sign.input_signatures[j].first; ++k)
                     boolVec.push_back(value);
             }
@@ -143,13 +500,13 @@ bool Matcher::splitBySimType2()
             for (const auto &po : cir1_po_partition.at(sign))
             {
                 auto result = splitBySimType2(po, cones1, cir1_pi_partitions.at(po), boolVec, i);
-                new_partition1[POSignature(cir1_pi_partitions.at(po))].insert(po);
+                new_partition1[POSignature(cir1_pi_partitions.at(po), sign.invariant_key)].insert(po);
                 split = split || result;
             }
             for (const auto &po : cir2_po_partition.at(sign))
             {
                 auto result = splitBySimType2(po, cones2, cir2_pi_partitions.at(po), boolVec, i);
-                new_partition2[POSignature(cir2_pi_partitions.at(po))].insert(po);
+                new_partition2[POSignature(cir2_pi_partitions.at(po), sign.invariant_key)].insert(po);
                 split = split || result;
             }
             if (split)
@@ -161,8 +518,19 @@ bool Matcher::splitBySimType2()
     return split;
 }
 
-void Matcher::splitBySupport(POPartition &po_partition, std::map<std::string, PIPartition> &pi_partitions, Circuit *cir, const Cones &cones)
+void Matcher::splitBySupport(POPartition &po_partition, std::map<std::string, PIPartition> &pi_partitions, Circuit *cir, const Cones &cones, SupportMode mode)
 {
+    if (mode == SupportMode::Functional)
+    {
+        std::vector<Circuit *> reduced_cones;
+        for (const auto &cluster : po_partition)
+        {
+            for (const auto &po : cluster.second)
+                reduced_cones.push_back(cones.at(po));
+        }
+        parallelFor(reduced_cones.size(), [&reduced_cones](std::size_t i) { reduceToFunctionalSupport(reduced_cones[i]); });
+    }
+
     auto partition_copy = po_partition;
     po_partition.clear();
 
@@ -185,16 +553,80 @@ void Matcher::splitBySupport(POPartition &po_partition, std::map<std::string, PI
     }
 }
 
+void Matcher::reduceToFunctionalSupport(Circuit *cone)
+{
+    constexpr std::size_t max_iterations = 1024;
+    IOSet support = FunctionalSupportCalculator(cone).getSupport(max_iterations);
+
+    //redundant inputs are tied to a constant so that every later phase works on the smaller cone
+    auto inputs = cone->getInputs();
+    for (const auto &pi : inputs)
+    {
+        if (support.find(pi) == support.end())
+            cone->stuckInput(pi, false);
+    }
+}
+
+void Matcher::splitByFingerprint(POPartition &po_partition1, POPartition &po_partition2)
+{
+    auto partition_copy1 = po_partition1;
+
+    for (const auto &cluster : partition_copy1)
+    {
+        if (cluster.first.isResolved() || (po_partition2.find(cluster.first) == po_partition2.end()))
+            continue;
+
+        std::map<Fingerprint, IOSet> fp_map1, fp_map2;
+        for (const auto &po : cluster.second)
+            fp_map1[FingerprintCalculator(cones1.at(po)).getFingerprint(po)].insert(po);
+        for (const auto &po : po_partition2.at(cluster.first))
+            fp_map2[FingerprintCalculator(cones2.at(po)).getFingerprint(po)].insert(po);
+
+        for (const auto &it : fp_map1)
+        {
+            auto it2 = fp_map2.find(it.first);
+            if (!it.first || it2 == fp_map2.end() || it2->second.size() != it.second.size())
+                continue;
+
+            //a structural hash may collide for different functions, so the groups are only refined further, never resolved
+            POSignature new_sign = cluster.first;
+            new_sign.invariant_key = mix(cluster.first.invariant_key ^ it.first);
+            for (const auto &po : it.second)
+                po_partition1.at(cluster.first).erase(po);
+            for (const auto &po : it2->second)
+                po_partition2.at(cluster.first).erase(po);
+            po_partition1.insert({new_sign, it.second});
+            po_partition2.insert({new_sign, it2->second});
+        }
+
+        if (po_partition1.at(cluster.first).empty())
+            po_partition1.erase(cluster.first);
+        if (po_partition2.at(cluster.first).empty())
+            po_partition2.erase(cluster.first);
+    }
+}
+
 void Matcher::splitByUnateness(POPartition &po_partition, std::map<std::string, PIPartition> &pi_partitions, Circuit *cir, const Cones &cones)
 {
+    auto cones_unateness = simulateCones<UnatenessMap>(po_partition, [this, &cones](const std::string &po)
+    {
+        return Simulator(cones.at(po), getPatternPool(cones.at(po))).simulate(1000);
+    });
+
     auto partition_copy = po_partition;
     po_partition.clear();
 
     for (const auto &cluster : partition_copy)
     {
+        if (cluster.first.isResolved())
+        {
+            po_partition.insert(cluster);
+            continue;
+        }
+
         for (const auto &po : cluster.second)
         {
-            auto input_unateness = Simulator(cones.at(po)).simulate(1000);
+            const auto &input_unateness = cones_unateness.at(po);
             PIPartition new_pi_partition;
             for (const auto& pi_cluster : pi_partitions.at(po))
             {
@@ -219,26 +651,39 @@ void Matcher::splitByUnateness(POPartition &po_partition, std::map<std::string,
                 }
             }
             pi_partitions.at(po) = new_pi_partition;
-            po_partition[POSignature(new_pi_partition)].insert(po);
+            po_partition[POSignature(new_pi_partition, cluster.first.invariant_key)].insert(po);
         }
     }
 }
 
 void Matcher::splitBySymmetry(POPartition &po_partition, std::map<std::string, PIPartition> &pi_partitions, Circuit *cir, const Cones &cones)
 {
+    auto cones_symmetry = simulateCones<SymmetryPartition>(po_partition, [this, &cones](const std::string &po)
+    {
+        return Simulator(cones.at(po), getPatternPool(cones.at(po))).simulateSym(1000);
+    });
+
     auto partition_copy = po_partition;
     po_partition.clear();
 
     for (const auto &cluster : partition_copy)
     {
+        if (cluster.first.isResolved())
+        {
+            po_partition.insert(cluster);
+            continue;
+        }
+
         for (const auto &po : cluster.second)
         {
-            auto sym_partition = Simulator(cones.at(po)).simulateSym(1000);
+            const auto &sym_partition = cones_symmetry.at(po);
             PIPartition new_pi_partition;
             for (const auto& pi_cluster : pi_partitions.at(po))
             {
+                //sub-clusters are ordered by symmetry and size rather than by input names, so that they stay
+                //aligned between the circuits; groups with equal keys cannot be told apart and are merged
+                std::map<std::pair<Symmetry, std::size_t>, std::pair<IOSet, std::size_t>> sym_clusters;
                 IOSet unviewed_inputs = pi_cluster.second;
-                IOSet non_sym_inputs;
                 for (const auto &pi : pi_cluster.second)
                 {
                     if (unviewed_inputs.find(pi) == unviewed_inputs.end())
@@ -251,7 +696,7 @@ void Matcher::splitBySymmetry(POPartition &po_partition, std::map<std::string, P
 
                         if (sym_cluster.first == Symmetry::None)
                         {
-                            non_sym_inputs.insert(pi);
+                            sym_clusters[{Symmetry::None, 0}].first.insert(pi);
                             unviewed_inputs.erase(pi);
                         }
                         else
@@ -262,41 +707,128 @@ void Matcher::splitBySymmetry(POPartition &po_partition, std::map<std::string, P
                                     log("Error during splitting by symmetry");
                                 unviewed_inputs.erase(sym_pi);
                             }
-                            PISignature new_pi_sign = pi_cluster.first;
-                            new_pi_sign.sym = sym_cluster.first;
-                            new_pi_partition.push_back({new_pi_sign, sym_cluster.second});
+                            auto &group = sym_clusters[{sym_cluster.first, sym_cluster.second.size()}];
+                            group.first.insert(sym_cluster.second.begin(), sym_cluster.second.end());
+                            ++group.second;
                         }
                         break;
                     }
                 }
-                if (!non_sym_inputs.empty())
+                for (const auto &it : sym_clusters)
                 {
-                    PISignature non_sym_sign = pi_cluster.first;
-                    non_sym_sign.sym = Symmetry::None;
-                    new_pi_partition.push_back({non_sym_sign, non_sym_inputs});
+                    //inputs of different symmetric groups are not symmetric with each other
+                    PISignature new_pi_sign = pi_cluster.first;
+                    new_pi_sign.sym = (it.second.second > 1) ? Symmetry::None : it.first.first;
+                    new_pi_partition.push_back({new_pi_sign, it.second.first});
                 }
             }
             pi_partitions.at(po) = new_pi_partition;
-            po_partition[POSignature(new_pi_partition)].insert(po);
+            po_partition[POSignature(new_pi_partition, cluster.first.invariant_key)].insert(po);
         }
     }
 }
 
-bool Matcher::splitBySimType1(const std::string &po, const Cones &cones, PIPartition &pi_partition, const std::vector<bool> &base_vec, std::size_t pi_cluster_ind)
+void Matcher::splitBySpectrum(POPartition &po_partition, std::map<std::string, PIPartition> &pi_partitions, const Cones &cones)
 {
-    auto partition_copy = pi_partition;
-    pi_partition.clear();
+    using SpectrumSignatures = std::pair<std::uint64_t, std::map<std::string, std::uint64_t>>;
+    auto cones_spectrum = simulateCones<SpectrumSignatures>(po_partition, [&cones](const std::string &po)
+    {
+        SpectrumSignatures signatures(0, {});
+        const Circuit *cone = cones.at(po);
+        if (!WalshSpectrum::isApplicable(cone))
+            return signatures;
+
+        TruthTable table(cone);
+        WalshSpectrum spectrum(table);
+        signatures.first = spectrum.getOrderSignature();
+        for (std::size_t var = 0; var < table.getInputCount(); ++var)
+            signatures.second.insert({table.getInputName(var), spectrum.getInputSignature(var)});
+        return signatures;
+    });
+
+    auto partition_copy = po_partition;
+    po_partition.clear();
+
+    for (const auto &cluster : partition_copy)
+    {
+        if (cluster.first.isResolved())
+        {
+            po_partition.insert(cluster);
+            continue;
+        }
+
+        for (const auto &po : cluster.second)
+        {
+            const auto &signatures = cones_spectrum.at(po);
+            if (!signatures.first)
+            {
+                po_partition[cluster.first].insert(po);
+                continue;
+            }
+
+            PIPartition new_pi_partition;
+            for (const auto &pi_cluster : pi_partitions.at(po))
+            {
+                std::map<std::uint64_t, IOSet> spectrum_map;
+                for (const auto &pi : pi_cluster.second)
+                {
+                    auto it = signatures.second.find(pi);
+                    spectrum_map[it == signatures.second.end() ? 0 : it->second].insert(pi);
+                }
+                for (const auto &it : spectrum_map)
+                {
+                    PISignature new_pi_sign = pi_cluster.first;
+                    new_pi_sign.spectrum = it.first;
+                    new_pi_partition.push_back({new_pi_sign, it.second});
+                }
+            }
+            pi_partitions.at(po) = new_pi_partition;
+            po_partition[POSignature(new_pi_partition, mix(cluster.first.invariant_key ^ signatures.first))].insert(po);
+        }
+    }
+}
+
+PatternPool *Matcher::getPatternPool(const Circuit *cone)
+{
+    std::lock_guard<std::mutex> lock(pattern_pools_mutex);
+    auto it = pattern_pools.find(cone);
+    if (it == pattern_pools.end())
+        it = pattern_pools.insert({cone, new PatternPool(cone)}).first;
+    return it->second;
+}
 
-    InVector in_vec;
+BitSimulator &Matcher::simulateBasePattern(const std::string &po, const Cones &cones, const PIPartition &pi_partition, const std::vector<bool> &base_vec)
+{
+    const Circuit *cone = cones.at(po);
+    auto it = cone_simulators.find(cone);
+    if (it == cone_simulators.end())
+        it = cone_simulators.insert({cone, new BitSimulator(cone)}).first;
+    BitSimulator &sim = *it->second;
+
+    //single word is enough: flips are then propagated by events from this pattern
+    if (sim.getWordCount() != 1)
+        sim.setWordCount(1);
     std::size_t j = 0;
-    for (std::size_t i = 0; i < partition_copy.size(); ++i)
+    for (const auto &pi_cluster : pi_partition)
     {
-        for (const auto &pi : partition_copy[i].second)
+        for (const auto &pi : pi_cluster.second)
         {
-            in_vec.insert({pi, base_vec[j]});
+            std::size_t pi_ind = sim.getInputIndex(pi);
+            if (pi_ind != BitSimulator::npos)
+                sim.getInputWords(pi_ind)[0] = base_vec[j] ? ~0ULL : 0;
             ++j;
         }
     }
+    sim.simulate();
+    return sim;
+}
+
+bool Matcher::splitBySimType1(const std::string &po, const Cones &cones, PIPartition &pi_partition, const std::vector<bool> &base_vec, std::size_t pi_cluster_ind)
+{
+    auto partition_copy = pi_partition;
+    pi_partition.clear();
+
+    BitSimulator &sim = simulateBasePattern(po, cones, partition_copy, base_vec);
 
     bool split = false;
     for (std::size_t i = 0; i < partition_copy.size(); ++i)
@@ -310,12 +842,12 @@ bool Matcher::splitBySimType1(const std::string &po, const Cones &cones, PIParti
         IOSet set0, set1;
         for (const auto &pi : partition_copy[i].second)
         {
-            InVector in_vec_flip = in_vec;
-            in_vec_flip.at(pi) = !in_vec_flip.at(pi);
-            if (cones.at(po)->evalOutput(po, in_vec_flip))
+            sim.flipInputs({sim.getInputIndex(pi)});
+            if (sim.getOutputWords()[0] & 1)
                 set1.insert(pi);
             else
                 set0.insert(pi);
+            sim.restoreFlips();
         }
         if (!set0.empty() && !set1.empty())
         {
@@ -343,16 +875,7 @@ bool Matcher::splitBySimType2(const std::string &po, const Cones &cones, PIParti
     auto partition_copy = pi_partition;
     pi_partition.clear();
 
-    InVector in_vec;
-    std::size_t j = 0;
-    for (std::size_t i = 0; i < partition_copy.size(); ++i)
-    {
-        for (const auto &pi : partition_copy[i].second)
-        {
-            in_vec.insert({pi, base_vec[j]});
-            ++j;
-        }
-    }
+    BitSimulator &sim = simulateBasePattern(po, cones, partition_copy, base_vec);
 
     bool split = false;
     for (std::size_t i = 0; i < partition_copy.size(); ++i)
@@ -363,24 +886,15 @@ bool Matcher::splitBySimType2(const std::string &po, const Cones &cones, PIParti
             continue;
         }
 
-        std::map<int, IOSet> val_sets;
-        for (const auto &pi1 : partition_copy[i].second)
-        {
-            InVector in_vec_flip = in_vec;
-            in_vec_flip.at(pi1) = !in_vec_flip.at(pi1);
-            int output_weight = 0;
-            for (const auto &pi2 : partition_copy[i].second)
-            {
-                if (pi1 == pi2)
-                    continue;
+        std::vector<std::size_t> pi_inds;
+        for (const auto &pi : partition_copy[i].second)
+            pi_inds.push_back(sim.getInputIndex(pi));
+        std::vector<int> output_weights = countPairFlips(sim, pi_inds);
 
-                InVector new_in_vec = in_vec_flip;
-                new_in_vec.at(pi2) = !new_in_vec.at(pi2);
-                if (cones.at(po)->evalOutput(po, new_in_vec))
-                    ++output_weight;
-            }
-            val_sets[output_weight].insert(pi1);
-        }
+        std::map<int, IOSet> val_sets;
+        std::size_t j = 0;
+        for (const auto &pi : partition_copy[i].second)
+            val_sets[output_weights[j++]].insert(pi);
 
         if (val_sets.size() > 1)
         {
@@ -402,11 +916,63 @@ bool Matcher::splitBySimType2(const std::string &po, const Cones &cones, PIParti
     return split;
 }
 
+std::vector<int> Matcher::countPairFlips(BitSimulator &sim, const std::vector<std::size_t> &pi_inds)
+{
+    //the base pattern is replicated into every lane and each lane flips one unordered pair on top of it
+    const std::size_t num_inputs = sim.getInputCount();
+    std::vector<Word> base(num_inputs);
+    for (std::size_t pi = 0; pi < num_inputs; ++pi)
+        base[pi] = (sim.getNodeWords(pi)[0] & 1) ? ~0ULL : 0;
+
+    std::vector<std::pair<std::size_t, std::size_t>> pairs;
+    for (std::size_t a = 0; a < pi_inds.size(); ++a)
+    {
+        for (std::size_t b = a + 1; b < pi_inds.size(); ++b)
+            pairs.push_back({a, b});
+    }
+
+    std::vector<int> output_weights(pi_inds.size(), 0);
+    for (std::size_t begin = 0; begin < pairs.size(); begin += max_pair_words * 64)
+    {
+        const std::size_t end = std::min(pairs.size(), begin + max_pair_words * 64),
+                          num_words = (end - begin + 63) / 64;
+        sim.setWordCount(num_words);
+        for (std::size_t pi = 0; pi < num_inputs; ++pi)
+            std::fill(sim.getInputWords(pi), sim.getInputWords(pi) + num_words, base[pi]);
+        for (std::size_t p = begin; p < end; ++p)
+        {
+            const Word lane = 1ULL << ((p - begin) % 64);
+            for (auto k : {pairs[p].first, pairs[p].second})
+            {
+                if (pi_inds[k] != BitSimulator::npos)
+                    sim.getInputWords(pi_inds[k])[(p - begin) / 64] ^= lane;
+            }
+        }
+        sim.simulate();
+
+        const Word *out = sim.getOutputWords();
+        for (std::size_t p = begin; p < end; ++p)
+        {
+            if ((out[(p - begin) / 64] >> ((p - begin) % 64)) & 1)
+            {
+                ++output_weights[pairs[p].first];
+                ++output_weights[pairs[p].second];
+            }
+        }
+    }
+    return output_weights;
+}
+
 std::pair<POPartition, POPartition> Matcher::getPOPartitions() const
 {
     return std::make_pair(cir1_po_partition, cir2_po_partition);
 }
 
+std::pair<std::map<std::string, PIPartition>, std::map<std::string, PIPartition>> Matcher::getPIPartitions() const
+{
+    return std::make_pair(cir1_pi_partitions, cir2_pi_partitions);
+}
+
 double Matcher::calculatePossibleMatchings() const
 {
     double output_matches_cnt = 0;
@@ -441,12 +1007,16 @@ double Matcher::calculatePossibleMatchings() const
 }
 
 POSignature::POSignature(Circuit *cir) :
-    support_size(-1)
+    support_size(-1),
+    canonical_form(0),
+    invariant_key(0)
 {
     input_signatures = { {cir->getInputs().size(), PISignature()} };
 }
 
-POSignature::POSignature(const PIPartition &pi_partition)
+POSignature::POSignature(const PIPartition &pi_partition, std::uint64_t invariant_key) :
+    canonical_form(0),
+    invariant_key(invariant_key)
 {
     support_size = 0;
     for (const auto &cluster : pi_partition)
@@ -457,11 +1027,22 @@ POSignature::POSignature(const PIPartition &pi_partition)
     }
 }
 
+bool POSignature::isResolved() const
+{
+    return canonical_form;
+}
+
 bool POSignature::operator <(const POSignature &rhs) const
 {
     if (support_size != rhs.support_size)
         return support_size < rhs.support_size;
 
+    if (canonical_form != rhs.canonical_form)
+        return canonical_form < rhs.canonical_form;
+
+    if (invariant_key != rhs.invariant_key)
+        return invariant_key < rhs.invariant_key;
+
     if (input_signatures.size() != rhs.input_signatures.size())
         return input_signatures.size() < rhs.input_signatures.size();
 
@@ -479,6 +1060,12 @@ bool POSignature::operator <(const POSignature &rhs) const
         if (pi_sign1.sym != pi_sign2.sym)
             return pi_sign1.sym < pi_sign2.sym;
 
+        if (pi_sign1.spectrum != pi_sign2.spectrum)
+            return pi_sign1.spectrum < pi_sign2.spectrum;
+
+        if (pi_sign1.influence != pi_sign2.influence)
+            return pi_sign1.influence < pi_sign2.influence;
+
         if (pi_sign1.simType1.size() != pi_sign2.simType1.size())
             return pi_sign1.simType1.size() < pi_sign2.simType1.size();
 
@@ -513,5 +1100,7 @@ bool POSignature::operator <(const POSignature &rhs) const
 
 PISignature::PISignature() :
     unat(Unateness::Unknown),
-    sym(Symmetry::Unknown)
+    sym(Symmetry::Unknown),
+    spectrum(0),
+    influence(0)
 {}
@@ -2,6 +2,10 @@
 
 #include "circuit.h"
 #include "simulator.h"
+#include "fingerprint.h"
+#include "weight_profile.h"
+#include "walsh_spectrum.h"
+#include <mutex>
 
 using IOSet = std::set<std::string>;
 
@@ -11,6 +15,8 @@ struct PISignature
 
     Unateness unat;
     Symmetry sym;
+    std::uint64_t spectrum; ///< Сигнатура первого и второго порядков спектра Уолша; 0 - не вычислялась
+    std::uint64_t influence; ///< Свёртка числа шаблонов, где инверсия входа меняет выход, и весов его кофакторов; 0 - не вычислялась
     std::vector<bool> simType1;
     std::vector<int> simType2;
 };
@@ -21,11 +27,14 @@ using PIPartition = std::vector<std::pair<PISignature, IOSet>>;
 struct POSignature
 {
     POSignature(Circuit *cir);
-    POSignature(const PIPartition &pi_partition);
+    POSignature(const PIPartition &pi_partition, std::uint64_t invariant_key = 0); ///< invariant_key наследуется от исходного кластера
 
     std::size_t support_size;
+    std::uint64_t canonical_form; ///< Ключ канонической формы, ненулевой только для выходов, сопоставленных по таблице истинности
+    std::uint64_t invariant_key; ///< Свёртка признаков выхода, не зависящих от перестановки входов (структурный хеш, корзины WeightProfile, спектр Уолша); 0 - не вычислялись
     PISignMask input_signatures;
 
+    bool isResolved() const; ///< Выходы кластера уже сопоставлены и не уточняются дальнейшими фазами
     bool operator < (const POSignature &rhs) const;
 };
 
@@ -33,19 +42,31 @@ using POPartition = std::map<POSignature, IOSet>;
 
 using Cones = std::map<std::string, Circuit *>;
 
+enum class SupportMode
+{
+    Structural, ///< Носитель по структуре конуса
+    Functional ///< Носитель без функционально избыточных входов, конусы сокращаются
+};
+
 class Matcher
 {
 public:
     Matcher(Circuit *cir1, Circuit *cir2);
     ~Matcher();
 
-    Matcher &splitBySupport();
+    Matcher &splitBySupport(SupportMode mode = SupportMode::Structural);
+    Matcher &splitByFingerprint();
+    Matcher &splitByCanonicalForm();
+    Matcher &splitByWeightProfile(); ///< До уточнения разбиений входов
     Matcher &splitByUnateness();
     Matcher &splitBySymmetry();
-    Matcher &splitBySimType1(std::size_t max_it);
-    Matcher &splitBySimType2(std::size_t max_it);
+    Matcher &splitBySpectrum(); ///< Конусы, для которых применим WalshSpectrum
+    Matcher &splitByInfluence(std::size_t max_patterns); ///< Раунды по influence_words слов, пока разбиение уточняется
+    Matcher &splitBySimType1(std::size_t max_it); ///< Пока max_it раундов подряд (или patience, если меньше) нет уточнения
+    Matcher &splitBySimType2(std::size_t max_it); ///< Аналогично splitBySimType1
 
     std::pair<POPartition, POPartition> getPOPartitions() const;
+    std::pair<std::map<std::string, PIPartition>, std::map<std::string, PIPartition>> getPIPartitions() const; ///< Кластеры входов выходов с равными сигнатурами соответствуют по номерам
 
     double calculatePossibleMatchings() const;
 private:
@@ -53,14 +74,34 @@ private:
     POPartition cir1_po_partition, cir2_po_partition;
     std::map<std::string, PIPartition> cir1_pi_partitions, cir2_pi_partitions;
     Cones cones1, cones2;
+    std::map<const Circuit *, BitSimulator *> cone_simulators; ///< Создаются при первой симуляции конуса
+    std::map<const Circuit *, PatternPool *> pattern_pools; ///< Общие для фаз unateness и symmetry
+    std::mutex pattern_pools_mutex;
+    Stimulus stimulus; ///< Базовые шаблоны фаз simType1/2, выбираемые последовательно
 
-    void splitBySupport(POPartition &po_partition, std::map<std::string, PIPartition> &pi_partitions, Circuit *cir, const Cones &cones);
+    static constexpr std::size_t influence_words = 16; ///< Шаблоны одного раунда оценки влияния входов
+    static constexpr std::size_t max_pair_words = 64; ///< Пары входов одной симуляции simType2, по 64 в слове
+
+    void splitBySupport(POPartition &po_partition, std::map<std::string, PIPartition> &pi_partitions, Circuit *cir, const Cones &cones, SupportMode mode);
+    static void reduceToFunctionalSupport(Circuit *cone);
+    void splitByFingerprint(POPartition &po_partition1, POPartition &po_partition2);
     void splitByUnateness(POPartition &po_partition, std::map<std::string, PIPartition> &pi_partitions, Circuit *cir, const Cones &cones);
     void splitBySymmetry(POPartition &po_partition, std::map<std::string, PIPartition> &pi_partitions, Circuit *cir, const Cones &cones);
+    void splitBySpectrum(POPartition &po_partition, std::map<std::string, PIPartition> &pi_partitions, const Cones &cones);
+
+    PatternPool *getPatternPool(const Circuit *cone); ///< Потокобезопасно, набор создаётся при первом обращении
+    BitSimulator &simulateBasePattern(const std::string &po, const Cones &cones, const PIPartition &pi_partition, const std::vector<bool> &base_vec);
+
+    bool splitByInfluence();
+    void calculateInfluence(const Circuit *cone, const PIPartition &pi_partition, const std::vector<Words> &cluster_words,
+                            std::vector<std::uint64_t> &influence);
 
     bool splitBySimType1();
     bool splitBySimType1(const std::string &po, const Cones &cones, PIPartition &pi_partition, const std::vector<bool> &base_vec, std::size_t pi_cluster_ind);
 
     bool splitBySimType2();
     bool splitBySimType2(const std::string &po, const Cones &cones, PIPartition &pi_partition, const std::vector<bool> &base_vec, std::size_t pi_cluster_ind);
+    /// Для каждого входа - число партнёров, совместная инверсия с которыми даёт 1 на выходе при базовом шаблоне
+    /// в разряде 0 sim; пары упаковываются в разряды шаблонов, число слов sim меняется
+    static std::vector<int> countPairFlips(BitSimulator &sim, const std::vector<std::size_t> &pi_inds);
 };
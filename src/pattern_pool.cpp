@@ -0,0 +1,118 @@
+#include "pattern_pool.h"
+#include <algorithm>
+
+PatternPool::PatternPool(const Circuit *cone) :
+    bit_sim(cone),
+    stimulus(cone->getName(), cone->getOutputs().front(), "patterns"),
+    flip_responses(bit_sim.getInputCount()),
+    num_added_patterns(0),
+    added_word(0)
+{
+    bit_sim.setWordCount(0);
+}
+
+void PatternPool::ensureWords(std::size_t num_words)
+{
+    const std::size_t old_num_words = bit_sim.getWordCount();
+    if (num_words <= old_num_words)
+        return;
+
+    resize(num_words);
+    for (std::size_t i = 0; i < bit_sim.getInputCount(); ++i)
+    {
+        for (std::size_t w = old_num_words; w < num_words; ++w)
+            bit_sim.getInputWords(i)[w] = stimulus.nextWord();
+    }
+    //cached flip responses keep their words, the new ones are computed on demand
+    bit_sim.simulateWords(old_num_words, num_words);
+}
+
+void PatternPool::addPattern(const InVector &pattern)
+{
+    //a fresh word gets the pattern in every bit, so that its unused bits repeat a valid pattern
+    const std::size_t bit = num_added_patterns++ % 64;
+    if (bit == 0)
+    {
+        added_word = bit_sim.getWordCount();
+        resize(added_word + 1);
+    }
+
+    for (std::size_t i = 0; i < bit_sim.getInputCount(); ++i)
+    {
+        auto it = pattern.find(bit_sim.getInputName(i));
+        const bool value = it != pattern.end() && it->second;
+        Word &word = bit_sim.getInputWords(i)[added_word];
+        if (bit == 0)
+            word = value ? ~0ULL : 0;
+        else
+            word = value ? (word | (1ULL << bit)) : (word & ~(1ULL << bit));
+    }
+
+    //only the word holding the pattern is re-evaluated, also in the cached flip responses that cover it
+    bit_sim.simulateWords(added_word, added_word + 1);
+    for (std::size_t i = 0; i < flip_responses.size(); ++i)
+    {
+        if (flip_responses[i].size() > added_word)
+            computeFlipResponse({i}, flip_responses[i], added_word, added_word + 1);
+    }
+}
+
+std::size_t PatternPool::getWordCount() const
+{
+    return bit_sim.getWordCount();
+}
+
+std::size_t PatternPool::getInputIndex(const std::string &pi) const
+{
+    return bit_sim.getInputIndex(pi);
+}
+
+std::size_t PatternPool::getInputCount() const
+{
+    return bit_sim.getInputCount();
+}
+
+const std::string &PatternPool::getInputName(std::size_t pi_ind) const
+{
+    return bit_sim.getInputName(pi_ind);
+}
+
+const Word *PatternPool::getInputWords(std::size_t pi_ind) const
+{
+    return bit_sim.getNodeWords(pi_ind);
+}
+
+const Word *PatternPool::getOutputWords() const
+{
+    return bit_sim.getOutputWords();
+}
+
+const Word *PatternPool::getFlipResponse(std::size_t pi_ind)
+{
+    Words &response = flip_responses.at(pi_ind);
+    if (response.size() < bit_sim.getWordCount())
+        computeFlipResponse({pi_ind}, response, response.size(), bit_sim.getWordCount());
+    return response.data();
+}
+
+const Word *PatternPool::getPairFlipResponse(std::size_t pi1_ind, std::size_t pi2_ind)
+{
+    computeFlipResponse({pi1_ind, pi2_ind}, pair_response, 0, bit_sim.getWordCount());
+    return pair_response.data();
+}
+
+void PatternPool::resize(std::size_t num_words)
+{
+    bit_sim.resizeWords(num_words);
+}
+
+void PatternPool::computeFlipResponse(const std::vector<std::size_t> &pi_inds, Words &response,
+                                      std::size_t word_begin, std::size_t word_end)
+{
+    //only the fanout cones of the flipped inputs are re-evaluated
+    bit_sim.flipInputs(pi_inds, word_begin, word_end);
+    const Word *out = bit_sim.getOutputWords();
+    response.resize(std::max(response.size(), word_end));
+    std::copy(out + word_begin, out + word_end, response.begin() + word_begin);
+    bit_sim.restoreFlips();
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "circuit.h"
+#include "bit_simulator.h"
+#include "stimulus.h"
+
+/// Случайные шаблоны конуса, просимулированные один раз, и отклики выхода на инверсию входов,
+/// общие для всех фаз уточнения
+class PatternPool
+{
+public:
+    PatternPool(const Circuit *cone); ///< Поток шаблонов определяется именами конуса и его единственного выхода
+
+    PatternPool(const PatternPool &) = delete;
+    PatternPool &operator=(const PatternPool &) = delete;
+
+    void ensureWords(std::size_t num_words); ///< Дополнение набора новыми шаблонами, имеющиеся слова сохраняются
+    void addPattern(const InVector &pattern); ///< Добавление контрпримера SAT; отсутствующие входы равны 0
+    std::size_t getWordCount() const;
+
+    std::size_t getInputIndex(const std::string &pi) const; ///< Номер входа или BitSimulator::npos
+    std::size_t getInputCount() const;
+    const std::string &getInputName(std::size_t pi_ind) const;
+    const Word *getInputWords(std::size_t pi_ind) const;
+    const Word *getOutputWords() const; ///< Отклик выхода на шаблоны набора
+
+    const Word *getFlipResponse(std::size_t pi_ind); ///< Отклик при инвертированном входе, вычисляется один раз
+    const Word *getPairFlipResponse(std::size_t pi1_ind, std::size_t pi2_ind); ///< Не запоминается, действителен до следующего вызова
+private:
+    BitSimulator bit_sim;
+    Stimulus stimulus;
+    std::vector<Words> flip_responses; ///< Отклики вычислены для первых size() слов набора
+    Words pair_response;
+    std::size_t num_added_patterns;
+    std::size_t added_word; ///< Слово, заполняемое контрпримерами
+
+    void resize(std::size_t num_words); ///< Новые слова нулевые, симуляция не выполняется
+    void computeFlipResponse(const std::vector<std::size_t> &pi_inds, Words &response, std::size_t word_begin, std::size_t word_end); ///< Слова [word_begin, word_end) отклика
+};
@@ -0,0 +1,206 @@
+#include "sim_jit.h"
+#include "utils.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+    std::size_t jit_threshold = 0;
+
+    const char *jit_symbol = "simulate_cone";
+
+    //FNV-1a, stable between runs so that the disk cache stays valid
+    std::uint64_t hashSource(const std::string &source)
+    {
+        std::uint64_t hash = 0xCBF29CE484222325ULL;
+        for (unsigned char c : source)
+            hash = (hash ^ c) * 0x100000001B3ULL;
+        return hash;
+    }
+
+    //the directory must belong to us and be closed to others, otherwise anybody could plant objects we would load
+    bool isPrivateDir(const std::string &dir)
+    {
+        struct stat st;
+        return lstat(dir.c_str(), &st) == 0 && S_ISDIR(st.st_mode) && st.st_uid == geteuid() && (st.st_mode & 077) == 0;
+    }
+
+    bool makePrivateDir(const std::string &dir)
+    {
+        if (mkdir(dir.c_str(), 0700) != 0 && errno != EEXIST)
+            return false;
+        return isPrivateDir(dir);
+    }
+
+    //objects of a per-run directory are never reused by later runs
+    std::string getRunDir()
+    {
+        static std::string run_dir;
+        if (run_dir.empty())
+        {
+            char pattern[] = "/tmp/matcher_jit.XXXXXX";
+            if (mkdtemp(pattern) && isPrivateDir(pattern))
+                run_dir = pattern;
+        }
+        return run_dir;
+    }
+
+    std::string findCacheDir()
+    {
+        std::string dir;
+        if (const char *jit_dir = std::getenv("MATCHER_JIT_DIR"))
+        {
+            dir = jit_dir;
+        }
+        else if (const char *cache_home = std::getenv("XDG_CACHE_HOME"))
+        {
+            dir = std::string(cache_home) + "/matcher_jit";
+        }
+        else if (const char *home = std::getenv("HOME"))
+        {
+            mkdir((std::string(home) + "/.cache").c_str(), 0700);
+            dir = std::string(home) + "/.cache/matcher_jit";
+        }
+
+        if (!dir.empty() && makePrivateDir(dir))
+            return dir;
+        if (!dir.empty())
+            log("JIT: %s is not a private directory, objects are kept for this run only", dir.c_str());
+        return getRunDir();
+    }
+
+    std::string getCacheDir()
+    {
+        static const std::string cache_dir = findCacheDir();
+        return cache_dir;
+    }
+
+    //the compiler is started without a shell, so paths and $CC are never interpreted
+    bool runCompiler(const std::string &source_path, const std::string &object_path)
+    {
+        const char *cc = std::getenv("CC");
+        std::vector<std::string> args;
+        std::istringstream cc_words(cc ? cc : "cc");
+        for (std::string word; cc_words >> word;)
+            args.push_back(word);
+        if (args.empty())
+            return false;
+        for (const char *arg : {"-O3", "-march=native", "-shared", "-fPIC", "-o"})
+            args.push_back(arg);
+        args.push_back(object_path);
+        args.push_back(source_path);
+
+        std::vector<char *> argv;
+        for (auto &arg : args)
+            argv.push_back(&arg[0]);
+        argv.push_back(nullptr);
+
+        const pid_t pid = fork();
+        if (pid < 0)
+            return false;
+        if (pid == 0)
+        {
+            const int null_fd = open("/dev/null", O_WRONLY);
+            if (null_fd >= 0)
+            {
+                dup2(null_fd, STDOUT_FILENO);
+                dup2(null_fd, STDERR_FILENO);
+            }
+            execvp(argv[0], argv.data());
+            _exit(127);
+        }
+
+        int status = 0;
+        while (waitpid(pid, &status, 0) < 0 && errno == EINTR)
+            ;
+        return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+
+    bool readFile(const std::string &path, std::string &content)
+    {
+        std::ifstream in(path);
+        if (!in)
+            return false;
+        std::stringstream ss;
+        ss << in.rdbuf();
+        content = ss.str();
+        return true;
+    }
+
+    //the object is built under a temporary name, so concurrent processes never load a partial file
+    bool buildObject(const std::string &source, const std::string &base)
+    {
+        const std::string tmp_base = base + "." + std::to_string(getpid());
+        {
+            std::ofstream out(tmp_base + ".c");
+            out << source;
+            if (!out)
+                return false;
+        }
+
+        bool built = runCompiler(tmp_base + ".c", tmp_base + ".so") &&
+                     std::rename((tmp_base + ".so").c_str(), (base + ".so").c_str()) == 0 &&
+                     std::rename((tmp_base + ".c").c_str(), (base + ".c").c_str()) == 0;
+        unlink((tmp_base + ".c").c_str());
+        unlink((tmp_base + ".so").c_str());
+        return built;
+    }
+}
+
+void setJitThreshold(std::size_t gate_words)
+{
+    jit_threshold = gate_words;
+}
+
+std::size_t getJitThreshold()
+{
+    return jit_threshold;
+}
+
+JitFunction compileJit(const std::string &source)
+{
+    static std::mutex jit_mutex;
+    static std::map<std::uint64_t, JitFunction> loaded;
+    std::lock_guard<std::mutex> lock(jit_mutex);
+
+    const std::uint64_t hash = hashSource(source);
+    auto it = loaded.find(hash);
+    if (it != loaded.end())
+        return it->second;
+
+    const std::string dir = getCacheDir();
+    if (dir.empty())
+    {
+        log("JIT: no private directory for objects");
+        return loaded[hash] = nullptr;
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "/cone_%016llx", static_cast<unsigned long long>(hash));
+    const std::string base = dir + name;
+
+    //an object from the disk cache is reused only if it was built from exactly the same code
+    std::string cached_source;
+    if (!(readFile(base + ".c", cached_source) && cached_source == source && access((base + ".so").c_str(), R_OK) == 0) &&
+        !buildObject(source, base))
+    {
+        log("JIT: cannot compile %s.c", base.c_str());
+        return loaded[hash] = nullptr;
+    }
+
+    //handles stay open for the lifetime of the process
+    void *handle = dlopen((base + ".so").c_str(), RTLD_NOW | RTLD_LOCAL);
+    JitFunction function = handle ? reinterpret_cast<JitFunction>(dlsym(handle, jit_symbol)) : nullptr;
+    if (!function)
+        log("JIT: cannot load %s.so", base.c_str());
+    return loaded[hash] = function;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "bit_simulator.h"
+
+/// Скомпилированная симуляция уровневого конуса: все элементы для слов [word_begin, word_end),
+/// значения узла node - в values[node * num_words + word]
+using JitFunction = void (*)(Word *values, std::size_t num_words, std::size_t word_begin, std::size_t word_end);
+
+void setJitThreshold(std::size_t gate_words); ///< Компиляция конуса после стольких вычислений элемента над словом; 0 - не компилировать
+std::size_t getJitThreshold();
+
+/// Компиляция C-кода, определяющего функцию simulate_cone с сигнатурой JitFunction, системным компилятором ($CC или cc) в разделяемую библиотеку и загрузка через dlopen.
+/// Библиотеки кэшируются по хешу кода в памяти и в закрытом каталоге пользователя $MATCHER_JIT_DIR ($XDG_CACHE_HOME/matcher_jit, ~/.cache/matcher_jit);
+/// если он не принадлежит пользователю или доступен другим, используется временный каталог только этого запуска.
+/// nullptr, если компиляция не удалась
+JitFunction compileJit(const std::string &source);
@@ -0,0 +1,312 @@
+#include "sim_kernels.h"
+#include <algorithm>
+#include <atomic>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIM_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    enum Op
+    {
+        OP_AND,
+        OP_OR,
+        OP_XOR,
+        OP_COPY
+    };
+
+    Op getOp(Function function)
+    {
+        switch (function)
+        {
+        case FUNCTION_AND:
+        case FUNCTION_NAND:
+            return OP_AND;
+        case FUNCTION_OR:
+        case FUNCTION_NOR:
+            return OP_OR;
+        case FUNCTION_XOR:
+        case FUNCTION_XNOR:
+            return OP_XOR;
+        default:
+            return OP_COPY;
+        }
+    }
+
+    Word getInversion(Function function)
+    {
+        switch (function)
+        {
+        case FUNCTION_NAND:
+        case FUNCTION_NOR:
+        case FUNCTION_XNOR:
+        case FUNCTION_NOT:
+            return ~0ULL;
+        default:
+            return 0;
+        }
+    }
+
+    template <Op op>
+    inline Word apply(Word acc, Word value)
+    {
+        return (op == OP_AND) ? (acc & value) : (op == OP_OR) ? (acc | value) : (op == OP_XOR) ? (acc ^ value) : acc;
+    }
+
+    //arity 0 stands for any number of fanins; fixed arities unroll the fanin loop at compile time
+    template <std::size_t arity>
+    inline std::size_t faninCount(std::size_t num_srcs)
+    {
+        return arity ? arity : num_srcs;
+    }
+
+    template <Op op, std::size_t arity>
+    void scalarLoop(Word *dst, const Word *const *srcs, std::size_t num_srcs,
+                    std::size_t begin, std::size_t end, Word inv)
+    {
+        for (std::size_t w = begin; w < end; ++w)
+        {
+            Word acc = srcs[0][w];
+            for (std::size_t k = 1; k < faninCount<arity>(num_srcs); ++k)
+                acc = apply<op>(acc, srcs[k][w]);
+            dst[w] = acc ^ inv;
+        }
+    }
+
+    //srcs holds num_srcs fanin pointers per gate, gate after gate
+    template <template <Op, std::size_t> class Loop, Op op, std::size_t arity>
+    void runGroup(Word *const *dsts, const Word *const *srcs, std::size_t num_srcs,
+                  std::size_t num_gates, std::size_t num_words, Word inv)
+    {
+        for (std::size_t g = 0; g < num_gates; ++g)
+            Loop<op, arity>::run(dsts[g], srcs + g * num_srcs, num_srcs, num_words, inv);
+    }
+
+    template <template <Op, std::size_t> class Loop, Op op>
+    void dispatchArity(Word *const *dsts, const Word *const *srcs, std::size_t num_srcs,
+                       std::size_t num_gates, std::size_t num_words, Word inv)
+    {
+        switch (op == OP_COPY ? 1 : num_srcs)
+        {
+        case 1:
+            runGroup<Loop, op, 1>(dsts, srcs, num_srcs, num_gates, num_words, inv);
+            break;
+        case 2:
+            runGroup<Loop, op, 2>(dsts, srcs, num_srcs, num_gates, num_words, inv);
+            break;
+        case 3:
+            runGroup<Loop, op, 3>(dsts, srcs, num_srcs, num_gates, num_words, inv);
+            break;
+        case 4:
+            runGroup<Loop, op, 4>(dsts, srcs, num_srcs, num_gates, num_words, inv);
+            break;
+        default:
+            runGroup<Loop, op, 0>(dsts, srcs, num_srcs, num_gates, num_words, inv);
+            break;
+        }
+    }
+
+    template <template <Op, std::size_t> class Loop>
+    void dispatchGroup(Function function, Word *const *dsts, const Word *const *srcs, std::size_t num_srcs,
+                       std::size_t num_gates, std::size_t num_words)
+    {
+        const Op op = getOp(function);
+        const Word inv = getInversion(function);
+        if (num_srcs == 0)
+        {
+            //gates without fanins evaluate to the identity of their operation
+            for (std::size_t g = 0; g < num_gates; ++g)
+                std::fill(dsts[g], dsts[g] + num_words, ((op == OP_AND) ? ~0ULL : 0ULL) ^ inv);
+            return;
+        }
+
+        switch (op)
+        {
+        case OP_AND:
+            dispatchArity<Loop, OP_AND>(dsts, srcs, num_srcs, num_gates, num_words, inv);
+            break;
+        case OP_OR:
+            dispatchArity<Loop, OP_OR>(dsts, srcs, num_srcs, num_gates, num_words, inv);
+            break;
+        case OP_XOR:
+            dispatchArity<Loop, OP_XOR>(dsts, srcs, num_srcs, num_gates, num_words, inv);
+            break;
+        default:
+            dispatchArity<Loop, OP_COPY>(dsts, srcs, num_srcs, num_gates, num_words, inv);
+            break;
+        }
+    }
+
+    template <template <Op, std::size_t> class Loop>
+    void dispatch(Function function, Word *dst, const Word *const *srcs, std::size_t num_srcs, std::size_t num_words)
+    {
+        dispatchGroup<Loop>(function, &dst, srcs, num_srcs, 1, num_words);
+    }
+
+    template <Op op, std::size_t arity>
+    struct ScalarLoop
+    {
+        static void run(Word *dst, const Word *const *srcs, std::size_t num_srcs, std::size_t num_words, Word inv)
+        {
+            scalarLoop<op, arity>(dst, srcs, num_srcs, 0, num_words, inv);
+        }
+    };
+
+    void evalScalar(Function function, Word *dst, const Word *const *srcs, std::size_t num_srcs, std::size_t num_words)
+    {
+        dispatch<ScalarLoop>(function, dst, srcs, num_srcs, num_words);
+    }
+
+    void evalGroupScalar(Function function, Word *const *dsts, const Word *const *srcs, std::size_t num_srcs,
+                         std::size_t num_gates, std::size_t num_words)
+    {
+        dispatchGroup<ScalarLoop>(function, dsts, srcs, num_srcs, num_gates, num_words);
+    }
+
+#ifdef SIM_KERNELS_X86
+    template <Op op>
+    __attribute__((target("avx2"))) inline __m256i apply256(__m256i acc, __m256i value)
+    {
+        return (op == OP_AND) ? _mm256_and_si256(acc, value) :
+               (op == OP_OR) ? _mm256_or_si256(acc, value) :
+               (op == OP_XOR) ? _mm256_xor_si256(acc, value) : acc;
+    }
+
+    template <Op op, std::size_t arity>
+    struct AVX2Loop
+    {
+        __attribute__((target("avx2")))
+        static void run(Word *dst, const Word *const *srcs, std::size_t num_srcs, std::size_t num_words, Word inv)
+        {
+            const __m256i vinv = _mm256_set1_epi64x(static_cast<long long>(inv));
+            std::size_t w = 0;
+            for (; w + 4 <= num_words; w += 4)
+            {
+                __m256i acc = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(srcs[0] + w));
+                for (std::size_t k = 1; k < faninCount<arity>(num_srcs); ++k)
+                    acc = apply256<op>(acc, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(srcs[k] + w)));
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + w), _mm256_xor_si256(acc, vinv));
+            }
+            scalarLoop<op, arity>(dst, srcs, num_srcs, w, num_words, inv);
+        }
+    };
+
+    void evalAVX2(Function function, Word *dst, const Word *const *srcs, std::size_t num_srcs, std::size_t num_words)
+    {
+        dispatch<AVX2Loop>(function, dst, srcs, num_srcs, num_words);
+    }
+
+    void evalGroupAVX2(Function function, Word *const *dsts, const Word *const *srcs, std::size_t num_srcs,
+                       std::size_t num_gates, std::size_t num_words)
+    {
+        dispatchGroup<AVX2Loop>(function, dsts, srcs, num_srcs, num_gates, num_words);
+    }
+
+    template <Op op>
+    __attribute__((target("avx512f"))) inline __m512i apply512(__m512i acc, __m512i value)
+    {
+        return (op == OP_AND) ? _mm512_and_si512(acc, value) :
+               (op == OP_OR) ? _mm512_or_si512(acc, value) :
+               (op == OP_XOR) ? _mm512_xor_si512(acc, value) : acc;
+    }
+
+    template <Op op, std::size_t arity>
+    struct AVX512Loop
+    {
+        __attribute__((target("avx512f")))
+        static void run(Word *dst, const Word *const *srcs, std::size_t num_srcs, std::size_t num_words, Word inv)
+        {
+            const __m512i vinv = _mm512_set1_epi64(static_cast<long long>(inv));
+            std::size_t w = 0;
+            for (; w + 8 <= num_words; w += 8)
+            {
+                __m512i acc = _mm512_loadu_si512(srcs[0] + w);
+                for (std::size_t k = 1; k < faninCount<arity>(num_srcs); ++k)
+                    acc = apply512<op>(acc, _mm512_loadu_si512(srcs[k] + w));
+                _mm512_storeu_si512(dst + w, _mm512_xor_si512(acc, vinv));
+            }
+            scalarLoop<op, arity>(dst, srcs, num_srcs, w, num_words, inv);
+        }
+    };
+
+    void evalAVX512(Function function, Word *dst, const Word *const *srcs, std::size_t num_srcs, std::size_t num_words)
+    {
+        dispatch<AVX512Loop>(function, dst, srcs, num_srcs, num_words);
+    }
+
+    void evalGroupAVX512(Function function, Word *const *dsts, const Word *const *srcs, std::size_t num_srcs,
+                         std::size_t num_gates, std::size_t num_words)
+    {
+        dispatchGroup<AVX512Loop>(function, dsts, srcs, num_srcs, num_gates, num_words);
+    }
+#endif
+
+    const GateKernel scalar_kernel = {KernelType::Scalar, "scalar", evalScalar, evalGroupScalar};
+#ifdef SIM_KERNELS_X86
+    const GateKernel avx2_kernel = {KernelType::AVX2, "avx2", evalAVX2, evalGroupAVX2};
+    const GateKernel avx512_kernel = {KernelType::AVX512, "avx512", evalAVX512, evalGroupAVX512};
+#endif
+
+    std::atomic<const GateKernel *> active_kernel(nullptr);
+}
+
+bool isKernelSupported(KernelType type)
+{
+#ifdef SIM_KERNELS_X86
+    __builtin_cpu_init();
+#endif
+    switch (type)
+    {
+    case KernelType::Scalar:
+        return true;
+#ifdef SIM_KERNELS_X86
+    case KernelType::AVX2:
+        return __builtin_cpu_supports("avx2");
+    case KernelType::AVX512:
+        return __builtin_cpu_supports("avx512f");
+#endif
+    default:
+        return false;
+    }
+}
+
+std::vector<KernelType> getSupportedKernels()
+{
+    std::vector<KernelType> result;
+    for (auto type : {KernelType::Scalar, KernelType::AVX2, KernelType::AVX512})
+    {
+        if (isKernelSupported(type))
+            result.push_back(type);
+    }
+    return result;
+}
+
+const GateKernel &getKernel(KernelType type)
+{
+    switch (type)
+    {
+#ifdef SIM_KERNELS_X86
+    case KernelType::AVX2:
+        return avx2_kernel;
+    case KernelType::AVX512:
+        return avx512_kernel;
+#endif
+    default:
+        return scalar_kernel;
+    }
+}
+
+const GateKernel &getActiveKernel()
+{
+    //the default is chosen once even when the first calls come from several workers
+    static const GateKernel &default_kernel = getKernel(getSupportedKernels().back());
+    const GateKernel *kernel = active_kernel.load();
+    return kernel ? *kernel : default_kernel;
+}
+
+void setActiveKernel(KernelType type)
+{
+    active_kernel = &getKernel(isKernelSupported(type) ? type : KernelType::Scalar);
+}
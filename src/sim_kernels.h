@@ -0,0 +1,29 @@
+#pragma once
+
+#include "bit_simulator.h"
+
+enum class KernelType
+{
+    Scalar,
+    AVX2, ///< 256-разрядные слова
+    AVX512 ///< 512-разрядные слова
+};
+
+/// Вычисление элемента над массивами слов: dst = function(srcs[0], ..., srcs[num_srcs - 1])
+struct GateKernel
+{
+    KernelType type;
+    const char *name;
+    void (*eval)(Function function, Word *dst, const Word *const *srcs, std::size_t num_srcs, std::size_t num_words);
+    /// Группа элементов одного типа и арности: dsts[g] = function(srcs[g * num_srcs], ..., srcs[g * num_srcs + num_srcs - 1]);
+    /// арности 1-4 вычисляются специализированными циклами без ветвлений
+    void (*eval_group)(Function function, Word *const *dsts, const Word *const *srcs, std::size_t num_srcs,
+                       std::size_t num_gates, std::size_t num_words);
+};
+
+bool isKernelSupported(KernelType type); ///< Проверка поддержки набора инструкций процессором (CPUID)
+std::vector<KernelType> getSupportedKernels();
+const GateKernel &getKernel(KernelType type);
+
+const GateKernel &getActiveKernel(); ///< При первом обращении выбирается самое широкое поддерживаемое ядро
+void setActiveKernel(KernelType type);
@@ -0,0 +1,51 @@
+#include "simulation_budget.h"
+#include <algorithm>
+
+constexpr std::size_t SimulationBudget::max_growth;
+std::size_t SimulationBudget::patience = 256;
+
+SimulationBudget::SimulationBudget(std::size_t max_patterns, std::size_t patterns_per_round, BudgetMode mode) :
+    max_rounds((max_patterns + patterns_per_round - 1) / patterns_per_round),
+    patience_rounds((patience + patterns_per_round - 1) / patterns_per_round),
+    num_rounds(0),
+    quiet_rounds(0),
+    mode(mode)
+{}
+
+void SimulationBudget::setPatience(std::size_t num_patterns)
+{
+    patience = num_patterns;
+}
+
+std::size_t SimulationBudget::getPatience()
+{
+    return patience;
+}
+
+std::size_t SimulationBudget::getInitialPatterns(std::size_t max_patterns)
+{
+    return patience ? std::min(max_patterns, patience) : max_patterns;
+}
+
+bool SimulationBudget::isExhausted() const
+{
+    if (mode == BudgetMode::SinceProgress)
+        return quiet_rounds >= (patience_rounds ? std::min(patience_rounds, max_rounds) : max_rounds);
+    if (patience_rounds == 0)
+        return num_rounds >= max_rounds;
+    if (quiet_rounds >= patience_rounds || num_rounds >= max_rounds * max_growth)
+        return true;
+    //past the base budget only a set that shrank in the last round keeps going
+    return num_rounds >= max_rounds && quiet_rounds > 0;
+}
+
+void SimulationBudget::update(bool changed)
+{
+    ++num_rounds;
+    quiet_rounds = changed ? 0 : quiet_rounds + 1;
+}
+
+std::size_t SimulationBudget::getRoundCount() const
+{
+    return num_rounds;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+
+/// Чем ограничено число шаблонов
+enum class BudgetMode
+{
+    Total, ///< max_patterns шаблонов всего, сокращающееся множество получает продление
+    SinceProgress ///< max_patterns шаблонов подряд без изменений: каждое изменение возобновляет бюджет
+};
+
+/// Адаптивный бюджет симуляции: раунды выдаются, пока множество кандидатов продолжает сокращаться.
+/// Множество, не менявшееся patience шаблонов, считается сошедшимся; сокращающееся множество
+/// может получить до max_growth базовых бюджетов
+class SimulationBudget
+{
+public:
+    SimulationBudget(std::size_t max_patterns, std::size_t patterns_per_round = 1, BudgetMode mode = BudgetMode::Total);
+
+    static constexpr std::size_t max_growth = 4;
+    static void setPatience(std::size_t num_patterns); ///< 0 - фиксированный бюджет max_patterns; в режиме SinceProgress - меньшее из двух
+    static std::size_t getPatience();
+    static std::size_t getInitialPatterns(std::size_t max_patterns); ///< Шаблоны, которые будут просимулированы в любом случае
+
+    bool isExhausted() const;
+    void update(bool changed); ///< Итог очередного раунда: изменилось ли множество кандидатов
+    std::size_t getRoundCount() const;
+private:
+    std::size_t max_rounds;
+    std::size_t patience_rounds;
+    std::size_t num_rounds;
+    std::size_t quiet_rounds; ///< Раунды с последнего изменения
+    BudgetMode mode;
+
+    static std::size_t patience;
+};
@@ -16,30 +16,55 @@ const SymmetrySet Simulator::all_symmetries =
     Symmetry::ESymmetry
 };
 
-Simulator::Simulator(Circuit *cir) :
-    cir(cir)
-{}
+Simulator::Simulator(Circuit *cir, PatternPool *pool) :
+    cir(cir),
+    decomposition(nullptr),
+    outer_simulator(nullptr),
+    pool(pool),
+    owns_pool(false),
+    truth_table(nullptr),
+    ternary_sim(nullptr),
+    ternary_stimulus(cir->getName(), cir->getOutputs().front(), "ternary")
+{
+    if (TruthTable::isApplicable(cir))
+        truth_table = new TruthTable(cir);
+}
+
+Simulator::~Simulator()
+{
+    if (owns_pool)
+        delete pool;
+    delete truth_table;
+    delete ternary_sim;
+    for (auto *block_simulator : block_simulators)
+        delete block_simulator;
+    delete outer_simulator;
+    delete decomposition;
+}
 
 UnatenessMap Simulator::simulate(std::size_t max_iterations)
 {
+    if (truth_table)
+        return simulateExact();
+    if (getDecomposition().isDecomposable())
+        return simulateBlocks(max_iterations);
+
     UnatenessMap input_properties;
 
-    const std::string po = cir->getOutputs().front(); //only one output in cone
+    //an output that stays binary with every input at X is constant and depends on none of them
+    bool constant_value = false;
+    if (getTernarySimulator().provesConstant(constant_value))
+    {
+        for (const auto &pi : cir->getInputs())
+            input_properties.insert({pi, {Unateness::PosUnate, Unateness::NegUnate}});
+        return input_properties;
+    }
+
+    getPool(max_iterations);
     for (const auto &pi : cir->getInputs())
     {
         input_properties.insert({pi, all_properties});
-        for (std::size_t it = 0; it < max_iterations; ++it)
-        {
-            auto vec_pair = generateDisjointPair({pi});
-//            log("Input vector 1 : %s", inVecToStr(vec_pair.first).c_str());
-//            log("Input vector 2 : %s", inVecToStr(vec_pair.second).c_str());
-            checkRemoval(input_properties.at(pi),
-                         vec_pair.first.at(pi), vec_pair.second.at(pi),
-                         cir->evalOutput(po, vec_pair.first), cir->evalOutput(po, vec_pair.second));
-
-            if (input_properties.empty())
-                break;
-        }
+        simulateProperties(pi, input_properties.at(pi), max_iterations);
         confirmProperties(pi, input_properties.at(pi));
         if (input_properties.at(pi).empty())
             input_properties.at(pi).insert(Unateness::Binate);
@@ -57,11 +82,14 @@ SymmetryPartition Simulator::simulateSym(std::size_t max_iterations)
 
     SymmetryPartition sym_partition;
 
-    const std::string po = cir->getOutputs().front(); //only one output in cone
-
     IOSet unviewed_inputs(cir->getInputs().begin(), cir->getInputs().end());
     IOSet non_sym_inputs;
 
+    //exact tables need no screening, otherwise only pairs surviving the bulk screen are simulated pairwise
+    std::vector<Words> candidates;
+    if (!truth_table)
+        candidates = screenNESymmetries(max_iterations);
+
     for (std::size_t i = 0; i < cir->getInputs().size()/* - 1*/; ++i)
     {
         const auto& pi1 = cir->getInputs()[i];
@@ -76,21 +104,9 @@ SymmetryPartition Simulator::simulateSym(std::size_t max_iterations)
             const auto &pi2 = cir->getInputs()[j];
             if (unviewed_inputs.find(pi2) == unviewed_inputs.end())
                 continue;
-            SymmetrySet sym_set = {Symmetry::NESymmetry/*, Symmetry::ESymmetry*/};
-            for (std::size_t it = 0; it < max_iterations; ++it)
-            {
-                auto vec_pair = generateDisjointPair({pi1, pi2});
-                //            log("Input vector 1 : %s", inVecToStr(vec_pair.first).c_str());
-                //            log("Input vector 2 : %s", inVecToStr(vec_pair.second).c_str());
-                checkRemoval(sym_set,
-                             vec_pair.first.at(pi1), vec_pair.first.at(pi2),
-                             vec_pair.second.at(pi1), vec_pair.second.at(pi2),
-                             cir->evalOutput(po, vec_pair.first), cir->evalOutput(po, vec_pair.second));
-
-                if (sym_set.empty())
-                    break;
-            }
-            confirmSymmetries(pi1, pi2, sym_set);
+            if (!candidates.empty() && !((candidates[i][j / 64] >> (j % 64)) & 1))
+                continue;
+            SymmetrySet sym_set = checkSymmetry(pi1, pi2, max_iterations);
             if (!sym_set.empty())
             {
                 sym = Symmetry::NESymmetry;
@@ -114,140 +130,438 @@ SymmetryPartition Simulator::simulateSym(std::size_t max_iterations)
     return std::move(sym_partition);
 }
 
-SVSymmetryMap Simulator::simulateSVSym(std::size_t max_iterations)
+PatternPool &Simulator::getPool(std::size_t max_iterations)
 {
-    SVSymmetryMap sv_symmetries;
-    const std::string po = cir->getOutputs().front(); //only one output in cone
-    for (const auto &pi1 : cir->getInputs())
+    if (!pool)
     {
-        for (const auto &pi2 : cir->getInputs())
-        {
-            if (pi2 == pi1)
-                continue;
+        pool = new PatternPool(cir);
+        owns_pool = true;
+    }
+    pool->ensureWords(blockCount(SimulationBudget::getInitialPatterns(max_iterations)));
+    return *pool;
+}
 
-            sv_symmetries[pi1].insert(std::make_pair(pi2, true));
-            sv_symmetries[pi1].insert(std::make_pair(pi2, false));
-        }
+BitSimulator &Simulator::getTernarySimulator()
+{
+    if (!ternary_sim)
+        ternary_sim = new BitSimulator(cir);
+    return *ternary_sim;
+}
+
+const ConeDecomposition &Simulator::getDecomposition()
+{
+    if (!decomposition)
+    {
+        decomposition = new ConeDecomposition(cir);
+        for (const auto &block : decomposition->getBlocks())
+            block_simulators.push_back(new Simulator(block.cone));
+        if (decomposition->getOuterCone())
+            outer_simulator = new Simulator(decomposition->getOuterCone());
+    }
+    return *decomposition;
+}
+
+void Simulator::growPool(std::size_t num_words)
+{
+    //doubling keeps the total resimulation cost linear in the final pool size
+    if (num_words > pool->getWordCount())
+        pool->ensureWords(std::max(num_words, 2 * pool->getWordCount()));
+}
+
+UnatenessMap Simulator::simulateBlocks(std::size_t max_iterations)
+{
+    //f = F(h_1, ..., h_k, rest) over disjoint supports with non-constant blocks: unateness of f in x of h_i
+    //is composed from unateness of h_i in x and of F in h_i, unateness in the rest is that of F
+    const UnatenessMap &properties = getOuterProperties(max_iterations);
+    const auto &blocks = decomposition->getBlocks();
+
+    UnatenessMap input_properties;
+    for (std::size_t i = 0; i < blocks.size(); ++i)
+    {
+        const UnatenessSet &block_properties = properties.at(blocks[i].net);
+        for (const auto &it : block_simulators[i]->simulate(max_iterations))
+            input_properties.insert({it.first, composeProperties(it.second, block_properties)});
+    }
+    for (const auto &pi : cir->getInputs())
+    {
+        if (decomposition->getBlockIndex(pi) < 0)
+            input_properties.insert({pi, properties.at(pi)});
+    }
+    return input_properties;
+}
 
-        for (std::size_t it = 0; it < max_iterations; ++it)
+const UnatenessMap &Simulator::getOuterProperties(std::size_t max_iterations)
+{
+    if (outer_properties.empty())
+    {
+        if (outer_simulator)
         {
-            auto vec_pair = generateDisjointPair({pi1});
-            //            log("Input vector 1 : %s", inVecToStr(vec_pair.first).c_str());
-            //            log("Input vector 2 : %s", inVecToStr(vec_pair.second).c_str());
-            checkRemoval(sv_symmetries.at(pi1),
-                         pi1, vec_pair.first,
-                         cir->evalOutput(po, vec_pair.first), cir->evalOutput(po, vec_pair.second));
-
-            if (sv_symmetries.at(pi1).empty())
-                break;
+            outer_properties = outer_simulator->simulate(max_iterations);
+        }
+        else
+        {
+            //AND/OR of the blocks, inverted or not
+            UnatenessSet properties = {decomposition->isInverted() ? Unateness::NegUnate : Unateness::PosUnate};
+            for (const auto &block : decomposition->getBlocks())
+                outer_properties.insert({block.net, properties});
         }
     }
-    return std::move(sv_symmetries);
+    return outer_properties;
 }
 
-std::pair<InVector, InVector> Simulator::generateDisjointPair(const std::vector<std::string> &disjoint_inputs) const
+SymmetrySet Simulator::checkSymmetry(const std::string &pi1, const std::string &pi2, std::size_t max_iterations)
 {
+    if (truth_table)
+    {
+        if (truth_table->isNESymmetric(truth_table->getInputIndex(pi1), truth_table->getInputIndex(pi2)))
+            return {Symmetry::NESymmetry};
+        return {};
+    }
+
+    //symmetry of inputs of the same block is decided on the block alone, unless the output ignores the block
+    Simulator *block_simulator = getBlockSimulator(pi1, pi2);
+    if (block_simulator && block_simulator != outer_simulator)
+    {
+        const auto &block = decomposition->getBlocks()[decomposition->getBlockIndex(pi1)];
+        const UnatenessSet &properties = getOuterProperties(max_iterations).at(block.net);
+        if (properties.find(Unateness::PosUnate) != properties.end() &&
+            properties.find(Unateness::NegUnate) != properties.end())
+            return {Symmetry::NESymmetry};
+    }
+    if (block_simulator)
+        return block_simulator->checkSymmetry(pi1, pi2, max_iterations);
+
+    SymmetrySet sym_set = {Symmetry::NESymmetry/*, Symmetry::ESymmetry*/};
+    getPool(max_iterations);
+    simulateSymmetries(pi1, pi2, sym_set, max_iterations);
+    confirmSymmetries(pi1, pi2, sym_set);
+    return sym_set;
+}
+
+std::vector<Words> Simulator::screenNESymmetries(std::size_t max_iterations)
+{
+    PatternPool &patterns = getPool(max_iterations);
     const auto &inputs = cir->getInputs();
+    const std::size_t num_inputs = inputs.size(), num_words = patterns.getWordCount();
 
-    InVector vector1, vector2;
+    std::vector<const Word *> in_words, flipped_words;
+    for (const auto &pi : inputs)
+    {
+        const std::size_t pi_ind = patterns.getInputIndex(pi);
+        in_words.push_back(patterns.getInputWords(pi_ind));
+        flipped_words.push_back(patterns.getFlipResponse(pi_ind));
+    }
 
-    for (const auto &i : inputs)
+    //where x_i = x_j, flipping x_i and flipping x_j give swapped patterns, so NE-symmetry needs equal responses there
+    std::vector<Words> candidates(num_inputs, Words((num_inputs + 63) / 64, 0));
+    for (std::size_t i = 0; i < num_inputs; ++i)
     {
-        bool value = (rand() % 2) == 0;
-        vector1.insert({i, value});
-        if (std::find(disjoint_inputs.begin(), disjoint_inputs.end(), i) == disjoint_inputs.end())
-            vector2.insert({i, value});
-        else
-            vector2.insert({i, !value});
+        for (std::size_t j = i + 1; j < num_inputs; ++j)
+        {
+            Word diff = 0;
+            for (std::size_t w = 0; w < num_words && !diff; ++w)
+                diff = (flipped_words[i][w] ^ flipped_words[j][w]) & ~(in_words[i][w] ^ in_words[j][w]);
+            if (!diff)
+            {
+                candidates[i][j / 64] |= 1ULL << (j % 64);
+                candidates[j][i / 64] |= 1ULL << (i % 64);
+            }
+        }
     }
+    return candidates;
+}
 
-    return std::make_pair(vector1, vector2);
+Simulator *Simulator::getBlockSimulator(const std::string &pi1, const std::string &pi2)
+{
+    if (!getDecomposition().isDecomposable())
+        return nullptr;
+
+    //inputs outside the blocks are decided on the outer function
+    int block_ind = decomposition->getBlockIndex(pi1);
+    if (block_ind != decomposition->getBlockIndex(pi2))
+        return nullptr;
+    return (block_ind < 0) ? outer_simulator : block_simulators[block_ind];
 }
 
-void Simulator::checkRemoval(UnatenessSet &properties, bool in_value1, bool in_value2, bool out_value1, bool out_value2)
+SVSymmetryMap Simulator::simulateSVSym(std::size_t max_iterations)
 {
-    if (out_value1 == out_value2 || in_value1 == in_value2) //checks only on disjoint input & output values
-        return;
+    if (truth_table)
+        return simulateSVSymExact();
 
-    auto properties_copy = properties;
-    for (auto prop : properties_copy)
+    SVSymmetryMap sv_symmetries;
+    getPool(max_iterations);
+    const std::size_t num_inputs = pool->getInputCount(), num_masks = (num_inputs + 63) / 64;
+    for (const auto &pi1 : cir->getInputs())
     {
-        bool erase = false;
+        //candidates (pi2, 1) and (pi2, 0) are bits of pi2 in the two masks
+        const std::size_t pi_ind = pool->getInputIndex(pi1);
+        Words sv_on_one(num_masks, 0);
+        for (std::size_t j = 0; j < num_inputs; ++j)
+        {
+            if (j != pi_ind)
+                sv_on_one[j / 64] |= 1ULL << (j % 64);
+        }
+        Words sv_on_zero = sv_on_one;
 
-        switch (prop)
+        auto hasCandidates = [&sv_on_one, &sv_on_zero]()
         {
-        case Unateness::PosUnate:
-            erase = out_value1 && !in_value1;
-            break;
-        case Unateness::NegUnate:
-            erase = out_value1 && in_value1;
-            break;
-        default:
-            break;
+            for (std::size_t m = 0; m < sv_on_one.size(); ++m)
+            {
+                if (sv_on_one[m] | sv_on_zero[m])
+                    return true;
+            }
+            return false;
+        };
+
+        SimulationBudget budget(max_iterations, 64);
+        for (std::size_t block = 0; hasCandidates() && !budget.isExhausted(); ++block)
+        {
+            growPool(block + 1);
+            Word out_diff = pool->getOutputWords()[block] ^ pool->getFlipResponse(pi_ind)[block];
+            budget.update(checkRemoval(sv_on_one, sv_on_zero, out_diff, block));
         }
 
-        if (erase)
+        SVSymmetrySet &sv_set = sv_symmetries[pi1];
+        for (std::size_t j = 0; j < num_inputs; ++j)
         {
-//            log("Erasing property %s", propToStr(prop).c_str());
-            properties.erase(prop);
+            if ((sv_on_one[j / 64] >> (j % 64)) & 1)
+                sv_set.insert(std::make_pair(pool->getInputName(j), true));
+            if ((sv_on_zero[j / 64] >> (j % 64)) & 1)
+                sv_set.insert(std::make_pair(pool->getInputName(j), false));
         }
     }
+    return std::move(sv_symmetries);
 }
 
-void Simulator::checkRemoval(SymmetrySet &symmetries, bool in_value11, bool in_value12, bool in_value21, bool in_value22, bool out_value1, bool out_value2)
+UnatenessMap Simulator::simulateExact() const
 {
-    if (out_value1 == out_value2) //checks only on disjoint input & output values
-        return;
-
-    auto symmetries_copy = symmetries;
-    for (auto sym : symmetries_copy)
+    UnatenessMap input_properties;
+    for (const auto &pi : cir->getInputs())
     {
-        bool erase = false;
+        const std::size_t var = truth_table->getInputIndex(pi);
+        UnatenessSet properties;
+        if (truth_table->isPosUnate(var))
+            properties.insert(Unateness::PosUnate);
+        if (truth_table->isNegUnate(var))
+            properties.insert(Unateness::NegUnate);
+        if (properties.empty())
+            properties.insert(Unateness::Binate);
+        input_properties.insert({pi, properties});
+    }
+    return input_properties;
+}
 
-        switch (sym)
+SVSymmetryMap Simulator::simulateSVSymExact() const
+{
+    SVSymmetryMap sv_symmetries;
+    for (const auto &pi1 : cir->getInputs())
+    {
+        SVSymmetrySet &sv_set = sv_symmetries[pi1];
+        for (const auto &pi2 : cir->getInputs())
         {
-        case Symmetry::NESymmetry:
-            erase = in_value11 && !in_value12;
-            break;
-        case Symmetry::ESymmetry:
-            erase = in_value11 && in_value12;
-            break;
-        default:
-            break;
+            if (pi2 == pi1)
+                continue;
+
+            for (bool value : {false, true})
+            {
+                if (truth_table->isSVSymmetric(truth_table->getInputIndex(pi1), truth_table->getInputIndex(pi2), value))
+                    sv_set.insert(std::make_pair(pi2, value));
+            }
         }
+    }
+    return sv_symmetries;
+}
+
+std::size_t Simulator::blockCount(std::size_t max_iterations)
+{
+    return (max_iterations + 63) / 64;
+}
+
+UnatenessSet Simulator::composeProperties(const UnatenessSet &inner, const UnatenessSet &outer)
+{
+    auto isIndependent = [](const UnatenessSet &properties)
+    {
+        return properties.find(Unateness::PosUnate) != properties.end() &&
+               properties.find(Unateness::NegUnate) != properties.end();
+    };
+    auto isBinate = [](const UnatenessSet &properties)
+    {
+        return properties.find(Unateness::PosUnate) == properties.end() &&
+               properties.find(Unateness::NegUnate) == properties.end();
+    };
+
+    //both functions depend on their inputs otherwise, and the inputs of a block are free of the rest
+    if (isIndependent(inner) || isIndependent(outer))
+        return {Unateness::PosUnate, Unateness::NegUnate};
+    if (isBinate(inner) || isBinate(outer))
+        return {Unateness::Binate};
+    bool same_sign = (inner.find(Unateness::PosUnate) != inner.end()) == (outer.find(Unateness::PosUnate) != outer.end());
+    return {same_sign ? Unateness::PosUnate : Unateness::NegUnate};
+}
+
+void Simulator::checkRemoval(UnatenessSet &properties, Word in_value, Word out_value1, Word out_value2)
+{
+    //cofactor values for every pattern regardless of which of the pair had the input set
+    Word neg_cofactor = (out_value1 & ~in_value) | (out_value2 & in_value),
+         pos_cofactor = (out_value1 & in_value) | (out_value2 & ~in_value);
+
+    if (neg_cofactor & ~pos_cofactor)
+        properties.erase(Unateness::PosUnate);
+    if (pos_cofactor & ~neg_cofactor)
+        properties.erase(Unateness::NegUnate);
+}
+
+void Simulator::checkRemoval(SymmetrySet &symmetries, Word in1_value, Word in2_value, Word out_value, Word swapped_value)
+{
+    //flipping both inputs swaps (1, 0) with (0, 1) where they differ and (0, 0) with (1, 1) where they are equal
+    Word out_diff = out_value ^ swapped_value,
+         distinct = in1_value ^ in2_value;
+    if (out_diff & distinct)
+        symmetries.erase(Symmetry::NESymmetry);
+    if (out_diff & ~distinct)
+        symmetries.erase(Symmetry::ESymmetry);
+}
 
-        if (erase)
+bool Simulator::checkRemoval(Words &sv_on_one, Words &sv_on_zero, Word out_diff, std::size_t word) const
+{
+    if (!out_diff) //checks only on disjoint output values
+        return false;
+
+    bool removed = false;
+    for (std::size_t m = 0; m < sv_on_one.size(); ++m)
+    {
+        //only live candidates are visited, lowest bit first
+        for (Word live = sv_on_one[m] | sv_on_zero[m]; live; live &= live - 1)
         {
-//            log("Erasing symmetry %s", symToStr(sym).c_str());
-            symmetries.erase(sym);
+            const std::size_t bit = __builtin_ctzll(live);
+            const Word mask = 1ULL << bit, in_value = pool->getInputWords(m * 64 + bit)[word];
+            if ((sv_on_one[m] & mask) && (out_diff & in_value))
+            {
+                sv_on_one[m] &= ~mask;
+                removed = true;
+            }
+            if ((sv_on_zero[m] & mask) && (out_diff & ~in_value))
+            {
+                sv_on_zero[m] &= ~mask;
+                removed = true;
+            }
         }
     }
+    return removed;
 }
 
-void Simulator::checkRemoval(SVSymmetrySet &sv_symmetries, const std::string &pi, const InVector &in_vec, bool out_value1, bool out_value2)
+void Simulator::refuteProperties(const std::string &pi, UnatenessSet &properties)
 {
-    if (out_value1 == out_value2) //checks only on disjoint input & output values
-        return;
+    const std::size_t pi_ind = pool->getInputIndex(pi);
+    const Word *in_words = pool->getInputWords(pi_ind),
+               *out_words = pool->getOutputWords(),
+               *flipped_words = pool->getFlipResponse(pi_ind);
+    for (std::size_t w = 0; w < pool->getWordCount() && !properties.empty(); ++w)
+        checkRemoval(properties, in_words[w], out_words[w], flipped_words[w]);
+}
 
-    auto sv_symmetries_copy = sv_symmetries;
-    for (auto sv_sym : sv_symmetries_copy)
+void Simulator::refuteBySensitizingPatterns(const std::string &pi, UnatenessSet &properties)
+{
+    constexpr std::size_t sensitizing_words = 4;
+    BitSimulator &sim = getTernarySimulator();
+    const std::size_t pi_ind = sim.getInputIndex(pi);
+    sim.setWordCount(sensitizing_words);
+    sim.generateSensitizingWords(pi_ind, ternary_stimulus);
+
+    //both cofactors are simulated on the same words of the other inputs
+    std::vector<Words> cofactors;
+    for (Word value : {Word(0), ~Word(0)})
+    {
+        std::fill(sim.getInputWords(pi_ind), sim.getInputWords(pi_ind) + sensitizing_words, value);
+        sim.simulate();
+        cofactors.push_back(sim.getOutputSignature());
+    }
+    for (std::size_t w = 0; w < sensitizing_words && !properties.empty(); ++w)
+        checkRemoval(properties, 0, cofactors[0][w], cofactors[1][w]);
+}
+
+void Simulator::refuteSymmetries(const std::string &pi1, const std::string &pi2, SymmetrySet &symmetries)
+{
+    const std::size_t pi1_ind = pool->getInputIndex(pi1),
+                      pi2_ind = pool->getInputIndex(pi2);
+    const Word *in1_words = pool->getInputWords(pi1_ind),
+               *in2_words = pool->getInputWords(pi2_ind),
+               *out_words = pool->getOutputWords(),
+               *swapped_words = pool->getPairFlipResponse(pi1_ind, pi2_ind);
+    for (std::size_t w = 0; w < pool->getWordCount() && !symmetries.empty(); ++w)
+        checkRemoval(symmetries, in1_words[w], in2_words[w], out_words[w], swapped_words[w]);
+}
+
+void Simulator::simulateProperties(const std::string &pi, UnatenessSet &properties, std::size_t max_iterations)
+{
+    const std::size_t pi_ind = pool->getInputIndex(pi);
+    SimulationBudget budget(max_iterations, 64);
+    for (std::size_t w = 0; !properties.empty() && !budget.isExhausted(); ++w)
+    {
+        growPool(w + 1);
+        const std::size_t num_properties = properties.size();
+        checkRemoval(properties, pool->getInputWords(pi_ind)[w], pool->getOutputWords()[w], pool->getFlipResponse(pi_ind)[w]);
+        budget.update(properties.size() != num_properties);
+    }
+}
+
+void Simulator::simulateSymmetries(const std::string &pi1, const std::string &pi2, SymmetrySet &symmetries, std::size_t max_iterations)
+{
+    const std::size_t pi1_ind = pool->getInputIndex(pi1),
+                      pi2_ind = pool->getInputIndex(pi2);
+    const Word *swapped_words = nullptr;
+    std::size_t num_swapped_words = 0;
+    SimulationBudget budget(max_iterations, 64);
+    for (std::size_t w = 0; !symmetries.empty() && !budget.isExhausted(); ++w)
     {
-        if (sv_sym.first != pi && in_vec.at(sv_sym.first) == sv_sym.second)
+        growPool(w + 1);
+        if (w >= num_swapped_words)
         {
-//            log("Erasing sv-symmetry %s", svSymToStr(sv_sym).c_str());
-            sv_symmetries.erase(sv_sym);
+            swapped_words = pool->getPairFlipResponse(pi1_ind, pi2_ind);
+            num_swapped_words = pool->getWordCount();
         }
+        const std::size_t num_symmetries = symmetries.size();
+        checkRemoval(symmetries, pool->getInputWords(pi1_ind)[w], pool->getInputWords(pi2_ind)[w],
+                     pool->getOutputWords()[w], swapped_words[w]);
+        budget.update(symmetries.size() != num_symmetries);
     }
 }
 
-void Simulator::confirmProperties(const std::string &pi, UnatenessSet &properties) const
+void Simulator::addCounterexample(InVector counterexample, const InVector &stuck_inputs)
+{
+    if (!pool || counterexample.empty())
+        return;
+    for (const auto &it : stuck_inputs)
+        counterexample[it.first] = it.second;
+    pool->addPattern(counterexample);
+}
+
+void Simulator::confirmProperties(const std::string &pi, UnatenessSet &properties)
 {
     const auto &po = cir->getOutputs().front();
+
+    //an input that is both pos- and neg-unate is redundant, which X-propagation often proves without SAT
+    if (properties.count(Unateness::PosUnate) && properties.count(Unateness::NegUnate))
+    {
+        BitSimulator &sim = getTernarySimulator();
+        if (sim.provesIndependence({sim.getInputIndex(pi)}))
+            return;
+    }
+
+    //patterns that can propagate a change of pi often refute what random ones missed, without SAT
+    refuteBySensitizingPatterns(pi, properties);
+
     auto properties_copy = properties;
 
     for (Unateness property : properties_copy)
     {
+        //counterexamples of the previous checks may already refute the property
+        refuteProperties(pi, properties);
+        if (properties.find(property) == properties.end())
+            continue;
+
         bool unsat = false;
+        InVector counterexample;
         switch (property)
         {
         case Unateness::PosUnate:
@@ -260,7 +574,7 @@ void Simulator::confirmProperties(const std::string &pi, UnatenessSet &propertie
             inv_pos_cofactor->invertOutput(po);
 
             Circuit *product_miter = Circuit::getMiter(neg_cofactor, inv_pos_cofactor, FUNCTION_AND);
-            unsat = checkMiter(product_miter);
+            unsat = checkMiter(product_miter, &counterexample);
 
             delete neg_cofactor;
             delete inv_pos_cofactor;
@@ -278,7 +592,7 @@ void Simulator::confirmProperties(const std::string &pi, UnatenessSet &propertie
             pos_cofactor->stuckInput(pi, true);
 
             Circuit *product_miter = Circuit::getMiter(inv_neg_cofactor, pos_cofactor, FUNCTION_AND);
-            unsat = checkMiter(product_miter);
+            unsat = checkMiter(product_miter, &counterexample);
 
             delete inv_neg_cofactor;
             delete pos_cofactor;
@@ -297,18 +611,31 @@ void Simulator::confirmProperties(const std::string &pi, UnatenessSet &propertie
         {
 //            log ("Property %s was not confirmed for input %s, erasing", propToStr(property).c_str(), pi.c_str());
             properties.erase(property);
+            addCounterexample(counterexample, {{pi, false}});
         }
     }
 }
 
-void Simulator::confirmSymmetries(const std::string &pi1, const std::string &pi2, SymmetrySet &symmetries) const
+void Simulator::confirmSymmetries(const std::string &pi1, const std::string &pi2, SymmetrySet &symmetries)
 {
+    Simulator *block_simulator = getBlockSimulator(pi1, pi2);
+    if (block_simulator)
+    {
+        block_simulator->confirmSymmetries(pi1, pi2, symmetries);
+        return;
+    }
+
     const auto &po = cir->getOutputs().front();
     auto symmetries_copy = symmetries;
 
     for (Symmetry symmetry : symmetries_copy)
     {
+        refuteSymmetries(pi1, pi2, symmetries);
+        if (symmetries.find(symmetry) == symmetries.end())
+            continue;
+
         bool unsat = false;
+        InVector counterexample;
         switch (symmetry)
         {
         case Symmetry::NESymmetry:
@@ -322,7 +649,9 @@ void Simulator::confirmSymmetries(const std::string &pi1, const std::string &pi2
             cofactor2->stuckInput(pi2, false);
 
             Circuit *product_miter = Circuit::getMiter(cofactor1, cofactor2);
-            unsat = checkMiter(product_miter);
+            unsat = checkMiter(product_miter, &counterexample);
+            if (!unsat)
+                addCounterexample(counterexample, {{pi1, false}, {pi2, true}});
 
             delete cofactor1;
             delete cofactor2;
@@ -342,7 +671,9 @@ void Simulator::confirmSymmetries(const std::string &pi1, const std::string &pi2
             cofactor2->stuckInput(pi2, true);
 
             Circuit *product_miter = Circuit::getMiter(cofactor1, cofactor2);
-            unsat = checkMiter(product_miter);
+            unsat = checkMiter(product_miter, &counterexample);
+            if (!unsat)
+                addCounterexample(counterexample, {{pi1, false}, {pi2, false}});
 
             delete cofactor1;
             delete cofactor2;
@@ -365,7 +696,7 @@ void Simulator::confirmSymmetries(const std::string &pi1, const std::string &pi2
     }
 }
 
-void Simulator::confirmSymmetries(const std::string &pi, SVSymmetrySet &sv_symmetries) const
+void Simulator::confirmSymmetries(const std::string &pi, SVSymmetrySet &sv_symmetries)
 {
     auto sv_symmetries_copy = sv_symmetries;
 
@@ -381,8 +712,9 @@ void Simulator::confirmSymmetries(const std::string &pi, SVSymmetrySet &sv_symme
         neg_cofactor->stuckInput(pi, false);
         neg_cofactor->stuckInput(sv_sym.first, sv_sym.second);
 
+        InVector counterexample;
         Circuit *product_miter = Circuit::getMiter(pos_cofactor, neg_cofactor);
-        unsat = checkMiter(product_miter);
+        unsat = checkMiter(product_miter, &counterexample);
 
         delete pos_cofactor;
         delete neg_cofactor;
@@ -396,6 +728,7 @@ void Simulator::confirmSymmetries(const std::string &pi, SVSymmetrySet &sv_symme
         {
 //            log ("SV-Symmetry %s was not confirmed for input %s, erasing", svSymToStr(sv_sym).c_str(), pi.c_str());
             sv_symmetries.erase(sv_sym);
+            addCounterexample(counterexample, {{pi, true}, {sv_sym.first, sv_sym.second}});
         }
     }
 }
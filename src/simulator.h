@@ -1,6 +1,10 @@
 #pragma once
 
 #include "circuit.h"
+#include "cone_decomposition.h"
+#include "pattern_pool.h"
+#include "truth_table.h"
+#include "simulation_budget.h"
 
 enum class Unateness
 {
@@ -41,29 +45,55 @@ std::string svSymSetToStr(const SVSymmetrySet &sv_symmetries);
 class Simulator
 {
 public:
-    Simulator(Circuit *cir);
+    Simulator(Circuit *cir, PatternPool *pool = nullptr); ///< Без общего набора шаблонов симулятор создаёт собственный
+    ~Simulator();
+
+    Simulator(const Simulator &) = delete;
+    Simulator &operator=(const Simulator &) = delete;
 
     UnatenessMap simulate(std::size_t max_iterations);
     SymmetryPartition simulateSym(std::size_t max_iterations);
     SVSymmetryMap simulateSVSym(std::size_t max_iterations);
 private:
     Circuit *cir;
+    ConeDecomposition *decomposition; ///< Создаётся при первом обращении, конусам с таблицей истинности не нужна
+    std::vector<Simulator *> block_simulators; ///< Симуляторы независимых блоков конуса
+    Simulator *outer_simulator; ///< Симулятор внешней функции от вершин блоков при разбиении по доминаторам
+    UnatenessMap outer_properties; ///< Унатность выхода по вершинам блоков и входам вне блоков
+    PatternPool *pool;
+    bool owns_pool;
+    TruthTable *truth_table; ///< Для конусов с малым носителем свойства вычисляются точно, без симуляции и SAT
+    BitSimulator *ternary_sim; ///< Троичные доказательства и шаблоны, чувствительные к входу; не трогает набор шаблонов
+    Stimulus ternary_stimulus;
+
+    PatternPool &getPool(std::size_t max_iterations); ///< Набор с начальными шаблонами бюджета max_iterations
+    BitSimulator &getTernarySimulator(); ///< Создаётся при первом обращении
+    const ConeDecomposition &getDecomposition(); ///< Вместе с симуляторами блоков
+    void growPool(std::size_t num_words);
+    UnatenessMap simulateBlocks(std::size_t max_iterations);
+    const UnatenessMap &getOuterProperties(std::size_t max_iterations); ///< Вычисляется при первом обращении
+    UnatenessMap simulateExact() const;
+    SVSymmetryMap simulateSVSymExact() const;
+    SymmetrySet checkSymmetry(const std::string &pi1, const std::string &pi2, std::size_t max_iterations);
+    std::vector<Words> screenNESymmetries(std::size_t max_iterations); ///< [i] - маска входов j (номера cir->getInputs()), ещё возможно NE-симметричных с i
+    Simulator *getBlockSimulator(const std::string &pi1, const std::string &pi2);
 
-    std::pair<InVector, InVector> generateDisjointPair(const std::vector<std::string> &disjoint_inputs) const;
+    static std::size_t blockCount(std::size_t max_iterations); ///< Число слов по 64 шаблона для заданного числа итераций
+    static UnatenessSet composeProperties(const UnatenessSet &inner, const UnatenessSet &outer); ///< Унатность f(h(x)) по унатности h по x и f по h
     static void checkRemoval(UnatenessSet &properties,
-                             bool in_value1, bool in_value2,
-                             bool out_value1, bool out_value2);
+                             Word in_value, Word out_value1, Word out_value2);
     static void checkRemoval(SymmetrySet &symmetries,
-                             bool in_value11, bool in_value12,
-                             bool in_value21, bool in_value22,
-                             bool out_value1, bool out_value2);
-    static void checkRemoval(SVSymmetrySet &sv_symmetries,
-                             const std::string &pi,
-                             const InVector &in_vec,
-                             bool out_value1, bool out_value2);
-    void confirmProperties(const std::string &pi, UnatenessSet &properties) const;
-    void confirmSymmetries(const std::string &pi1, const std::string &pi2, SymmetrySet &symmetries) const;
-    void confirmSymmetries(const std::string &pi, SVSymmetrySet &sv_symmetries) const;
+                             Word in1_value, Word in2_value, Word out_value, Word swapped_value);
+    bool checkRemoval(Words &sv_on_one, Words &sv_on_zero, Word out_diff, std::size_t word) const; ///< Маски входов набора; true, если кандидаты удалены
+    void simulateProperties(const std::string &pi, UnatenessSet &properties, std::size_t max_iterations); ///< Шаблоны выдаются по бюджету SimulationBudget
+    void simulateSymmetries(const std::string &pi1, const std::string &pi2, SymmetrySet &symmetries, std::size_t max_iterations);
+    void refuteProperties(const std::string &pi, UnatenessSet &properties); ///< Проверка на всех шаблонах набора, включая контрпримеры
+    void refuteBySensitizingPatterns(const std::string &pi, UnatenessSet &properties); ///< Проверка на шаблонах, где выход может зависеть от pi
+    void refuteSymmetries(const std::string &pi1, const std::string &pi2, SymmetrySet &symmetries);
+    void addCounterexample(InVector counterexample, const InVector &stuck_inputs); ///< Контрпример SAT дополняется значениями константных входов
+    void confirmProperties(const std::string &pi, UnatenessSet &properties);
+    void confirmSymmetries(const std::string &pi1, const std::string &pi2, SymmetrySet &symmetries);
+    void confirmSymmetries(const std::string &pi, SVSymmetrySet &sv_symmetries);
 
     static const UnatenessSet all_properties;
     static const SymmetrySet all_symmetries;
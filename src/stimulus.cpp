@@ -0,0 +1,69 @@
+#include "stimulus.h"
+
+std::uint64_t Stimulus::seed = 0;
+
+namespace
+{
+    //splitmix64 finalizer, a bijective mix with full avalanche
+    std::uint64_t mix(std::uint64_t x)
+    {
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+    }
+
+    //FNV-1a, so that stream numbers do not depend on the standard library
+    std::uint64_t hashName(const std::string &name)
+    {
+        std::uint64_t hash = 0xCBF29CE484222325ULL;
+        for (unsigned char c : name)
+            hash = (hash ^ c) * 0x100000001B3ULL;
+        return hash;
+    }
+}
+
+Stimulus::Stimulus(const std::string &stream_name) :
+    stream(hashName(stream_name)),
+    counter(0),
+    bits(0),
+    bits_left(0)
+{}
+
+Stimulus::Stimulus(const std::string &circuit_name, const std::string &po, const std::string &phase) :
+    Stimulus(circuit_name + "/" + po + "/" + phase)
+{}
+
+Word Stimulus::nextWord()
+{
+    return generate(stream, counter++);
+}
+
+bool Stimulus::nextBool()
+{
+    if (bits_left == 0)
+    {
+        bits = nextWord();
+        bits_left = 64;
+    }
+    --bits_left;
+    bool value = bits & 1;
+    bits >>= 1;
+    return value;
+}
+
+Word Stimulus::generate(std::uint64_t stream, std::uint64_t counter)
+{
+    //the key depends on the seed and the stream only, the counter walks a Weyl sequence under the key
+    std::uint64_t key = mix(seed ^ mix(stream + 0x9E3779B97F4A7C15ULL));
+    return mix(key + (counter + 1) * 0x9E3779B97F4A7C15ULL);
+}
+
+void Stimulus::setSeed(std::uint64_t new_seed)
+{
+    seed = new_seed;
+}
+
+std::uint64_t Stimulus::getSeed()
+{
+    return seed;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+using Word = std::uint64_t; ///< 64 шаблона, по одному в каждом разряде
+
+/// Источник случайных шаблонов: слово однозначно определяется зерном, потоком и номером слова,
+/// поэтому результат не зависит от числа рабочих потоков и порядка их выполнения
+class Stimulus
+{
+public:
+    Stimulus(const std::string &stream_name); ///< Поток именуется выходом или фазой, которые он обслуживает
+    Stimulus(const std::string &circuit_name, const std::string &po, const std::string &phase); ///< Свой поток у каждой фазы каждого выхода каждой схемы
+
+    Word nextWord();
+    bool nextBool(); ///< Очередной разряд, слово расходуется по одному разряду
+
+    static Word generate(std::uint64_t stream, std::uint64_t counter);
+
+    static void setSeed(std::uint64_t new_seed);
+    static std::uint64_t getSeed();
+private:
+    std::uint64_t stream;
+    std::uint64_t counter;
+    Word bits;
+    std::size_t bits_left;
+
+    static std::uint64_t seed;
+};
@@ -1,4 +1,6 @@
 #include "support_calculator.h"
+#include "checker.h"
+#include "simulation_budget.h"
 
 IOSupportCalculator::IOSupportCalculator(Circuit *cir) :
     cir(cir)
@@ -50,3 +52,94 @@ IOSet IOSupportCalculator::getSupport(const std::string &o)
     }
     return supportCache.at(o);
 }
+
+FunctionalSupportCalculator::FunctionalSupportCalculator(Circuit *cone) :
+    cone(cone),
+    bit_sim(cone),
+    stimulus(cone->getName(), cone->getOutputs().front(), "support")
+{}
+
+IOSet FunctionalSupportCalculator::getSupport(std::size_t max_iterations)
+{
+    IOSet support, undecided(cone->getInputs().begin(), cone->getInputs().end());
+
+    //a constant output has an empty support
+    bool constant_value = false;
+    if (bit_sim.provesConstant(constant_value))
+        return support;
+
+    //64 patterns per word, every undecided input is flipped against the same base words
+    SimulationBudget budget(max_iterations, 64);
+    while (!undecided.empty() && !budget.isExhausted())
+    {
+        const std::size_t num_undecided = undecided.size();
+        bit_sim.randomizeInputs(stimulus);
+        bit_sim.simulate();
+        Word base = *bit_sim.getOutputWords();
+
+        auto undecided_copy = undecided;
+        for (const auto &pi : undecided_copy)
+        {
+            Word *in_word = bit_sim.getInputWords(bit_sim.getInputIndex(pi));
+            *in_word = ~*in_word;
+            bit_sim.simulate();
+            if (*bit_sim.getOutputWords() != base)
+            {
+                support.insert(pi);
+                undecided.erase(pi);
+            }
+            *in_word = ~*in_word;
+        }
+        budget.update(undecided.size() != num_undecided);
+    }
+
+    //inputs random patterns missed get patterns that can propagate their change
+    auto undecided_copy = undecided;
+    for (const auto &pi : undecided_copy)
+    {
+        const std::size_t pi_ind = bit_sim.getInputIndex(pi);
+        bit_sim.generateSensitizingWords(pi_ind, stimulus);
+        bit_sim.simulate();
+        Word base = *bit_sim.getOutputWords();
+        Word *in_word = bit_sim.getInputWords(pi_ind);
+        *in_word = ~*in_word;
+        bit_sim.simulate();
+        if (*bit_sim.getOutputWords() != base)
+        {
+            support.insert(pi);
+            undecided.erase(pi);
+        }
+    }
+
+    //three-valued simulation proves most redundant inputs at once, SAT is left for the rest
+    std::vector<std::size_t> x_inputs;
+    for (const auto &pi : undecided)
+        x_inputs.push_back(bit_sim.getInputIndex(pi));
+    if (x_inputs.empty() || bit_sim.provesIndependence(x_inputs))
+        return support;
+
+    for (const auto &pi : undecided)
+    {
+        if (!bit_sim.provesIndependence({bit_sim.getInputIndex(pi)}) && !isRedundant(pi))
+            support.insert(pi);
+    }
+    return support;
+}
+
+bool FunctionalSupportCalculator::isRedundant(const std::string &pi) const
+{
+    Circuit *neg_cofactor = new Circuit(*cone);
+    neg_cofactor->stuckInput(pi, false);
+
+    Circuit *pos_cofactor = new Circuit(*cone);
+    pos_cofactor->stuckInput(pi, true);
+
+    Circuit *miter = Circuit::getMiter(neg_cofactor, pos_cofactor);
+    bool unsat = checkMiter(miter);
+
+    delete neg_cofactor;
+    delete pos_cofactor;
+    delete miter;
+
+    return unsat;
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "circuit.h"
+#include "bit_simulator.h"
 
 using IOSet = std::set<std::string>;
 using IOSupport = std::map<std::string, IOSet>;
@@ -18,3 +19,18 @@ private:
 
     IOSet getSupport(const std::string &p);
 };
+
+/// Функциональный носитель конуса: входы, от которых значение выхода действительно зависит
+class FunctionalSupportCalculator
+{
+public:
+    FunctionalSupportCalculator(Circuit *cone);
+
+    IOSet getSupport(std::size_t max_iterations); ///< Поразрядно-параллельная симуляция, шаблоны, чувствительные к входу, троичная симуляция, затем SAT для оставшихся входов
+private:
+    Circuit *cone;
+    BitSimulator bit_sim;
+    Stimulus stimulus;
+
+    bool isRedundant(const std::string &pi) const;
+};
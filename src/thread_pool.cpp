@@ -0,0 +1,124 @@
+#include "thread_pool.h"
+#include <algorithm>
+#include <memory>
+
+namespace
+{
+    thread_local bool inside_parallel_for = false;
+
+    std::unique_ptr<ThreadPool> &getSharedPoolHolder()
+    {
+        //initialized once even when the first loops are started from several threads
+        static std::unique_ptr<ThreadPool> shared_pool(new ThreadPool(0));
+        return shared_pool;
+    }
+
+    ThreadPool &getSharedPool()
+    {
+        return *getSharedPoolHolder();
+    }
+}
+
+ThreadPool::ThreadPool(std::size_t num_threads) :
+    generation(0),
+    pending_workers(0),
+    stopping(false),
+    body(nullptr),
+    count(0),
+    next_index(0)
+{
+    if (num_threads == 0)
+        num_threads = std::max(1U, std::thread::hardware_concurrency());
+
+    //the calling thread takes part in every loop
+    for (std::size_t i = 1; i < num_threads; ++i)
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    start_cond.notify_all();
+    for (auto &worker : workers)
+        worker.join();
+}
+
+std::size_t ThreadPool::getThreadCount() const
+{
+    return workers.size() + 1;
+}
+
+void ThreadPool::parallelFor(std::size_t new_count, const std::function<void(std::size_t)> &new_body)
+{
+    if (workers.empty() || new_count < 2 || inside_parallel_for)
+    {
+        for (std::size_t i = 0; i < new_count; ++i)
+            new_body(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        body = &new_body;
+        count = new_count;
+        next_index = 0;
+        pending_workers = workers.size();
+        ++generation;
+    }
+    start_cond.notify_all();
+
+    inside_parallel_for = true;
+    runBody();
+    inside_parallel_for = false;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done_cond.wait(lock, [this] { return pending_workers == 0; });
+    body = nullptr;
+}
+
+void ThreadPool::workerLoop()
+{
+    inside_parallel_for = true;
+
+    std::size_t seen_generation = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        start_cond.wait(lock, [this, seen_generation] { return stopping || generation != seen_generation; });
+        if (stopping)
+            return;
+        seen_generation = generation;
+
+        lock.unlock();
+        runBody();
+        lock.lock();
+
+        if (--pending_workers == 0)
+            done_cond.notify_one();
+    }
+}
+
+void ThreadPool::runBody()
+{
+    for (std::size_t i = next_index++; i < count; i = next_index++)
+        (*body)(i);
+}
+
+void setThreadCount(std::size_t num_threads)
+{
+    //must not run concurrently with loops on the shared pool
+    getSharedPoolHolder().reset(new ThreadPool(num_threads));
+}
+
+std::size_t getThreadCount()
+{
+    return getSharedPool().getThreadCount();
+}
+
+void parallelFor(std::size_t count, const std::function<void(std::size_t)> &body)
+{
+    getSharedPool().parallelFor(count, body);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// Пул рабочих потоков для параллельных циклов
+class ThreadPool
+{
+public:
+    ThreadPool(std::size_t num_threads); ///< Число потоков вместе с вызывающим, 0 - по числу ядер
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    std::size_t getThreadCount() const;
+
+    /// Выполнение body(0), ..., body(count - 1) на всех потоках пула; вложенные циклы выполняются последовательно
+    void parallelFor(std::size_t count, const std::function<void(std::size_t)> &body);
+private:
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable start_cond, done_cond;
+    std::size_t generation; ///< Номер текущего цикла, по которому рабочие потоки узнают о новой работе
+    std::size_t pending_workers;
+    bool stopping;
+
+    const std::function<void(std::size_t)> *body;
+    std::size_t count;
+    std::atomic<std::size_t> next_index;
+
+    void workerLoop();
+    void runBody();
+};
+
+void setThreadCount(std::size_t num_threads); ///< Пересоздание общего пула, 0 - по числу ядер
+std::size_t getThreadCount();
+void parallelFor(std::size_t count, const std::function<void(std::size_t)> &body); ///< Цикл на общем пуле
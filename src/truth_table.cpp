@@ -0,0 +1,220 @@
+#include "truth_table.h"
+#include <algorithm>
+#include <mutex>
+
+// canonical form computation from the ABC library
+extern "C" unsigned Abc_TtCanonicize(std::uint64_t *pTruth, int nVars, char *pCanonPerm);
+
+constexpr std::size_t TruthTable::max_supported_inputs;
+constexpr std::size_t TruthTable::max_canonical_inputs;
+std::size_t TruthTable::max_inputs = 16;
+
+namespace
+{
+    constexpr std::size_t word_vars = 6; //enumerated inside a single word
+    constexpr std::size_t chunk_vars = 10; //enumerated across the words of one simulator run
+
+    std::uint64_t mix(std::uint64_t x)
+    {
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+    }
+}
+
+std::uint64_t CanonicalForm::getKey() const
+{
+    std::uint64_t key = mix(phase + 0x9E3779B97F4A7C15ULL * (perm.size() + 1));
+    for (auto word : table)
+        key = mix(key ^ word);
+    return key ? key : 1;
+}
+
+TruthTable::TruthTable(const Circuit *cone) :
+    num_inputs(cone->getInputs().size())
+{
+    BitSimulator sim(cone);
+    for (std::size_t i = 0; i < num_inputs; ++i)
+    {
+        input_names.push_back(sim.getInputName(i));
+        input_index.insert({input_names.back(), i});
+    }
+
+    //with fewer than 6 inputs the patterns repeat inside the single word, so every bit is still a valid minterm
+    const std::size_t table_vars = std::max(num_inputs, word_vars),
+                      sim_vars = std::min(table_vars, word_vars + chunk_vars);
+    const std::size_t chunk_words = std::size_t(1) << (sim_vars - word_vars),
+                      num_chunks = std::size_t(1) << (table_vars - sim_vars);
+    table.resize(chunk_words * num_chunks);
+
+    //large chunks are split between threads by the simulator itself
+    sim.setWordCount(chunk_words);
+    for (std::size_t chunk = 0; chunk < num_chunks; ++chunk)
+    {
+        for (std::size_t var = 0; var < num_inputs; ++var)
+        {
+            Word *words = sim.getInputWords(var);
+            for (std::size_t w = 0; w < chunk_words; ++w)
+            {
+                if (var < word_vars)
+                    words[w] = variableMask(var);
+                else if (var < sim_vars)
+                    words[w] = ((w >> (var - word_vars)) & 1) ? ~0ULL : 0;
+                else
+                    words[w] = ((chunk >> (var - sim_vars)) & 1) ? ~0ULL : 0;
+            }
+        }
+        sim.simulate();
+
+        const Word *out = sim.getOutputWords();
+        std::copy(out, out + chunk_words, table.begin() + chunk * chunk_words);
+    }
+}
+
+void TruthTable::setMaxInputs(std::size_t num_inputs)
+{
+    max_inputs = std::min(num_inputs, max_supported_inputs);
+}
+
+std::size_t TruthTable::getMaxInputs()
+{
+    return max_inputs;
+}
+
+bool TruthTable::isApplicable(const Circuit *cone)
+{
+    return max_inputs > 0 && cone->getInputs().size() <= max_inputs && cone->getOutputs().size() == 1;
+}
+
+std::size_t TruthTable::getInputCount() const
+{
+    return num_inputs;
+}
+
+std::size_t TruthTable::getInputIndex(const std::string &pi) const
+{
+    auto it = input_index.find(pi);
+    return it == input_index.end() ? BitSimulator::npos : it->second;
+}
+
+const std::string &TruthTable::getInputName(std::size_t var) const
+{
+    return input_names.at(var);
+}
+
+const Words &TruthTable::getWords() const
+{
+    return table;
+}
+
+bool TruthTable::isPosUnate(std::size_t var) const
+{
+    Words neg = cofactor(table, var, false), pos = cofactor(table, var, true);
+    for (std::size_t w = 0; w < table.size(); ++w)
+    {
+        if (neg[w] & ~pos[w])
+            return false;
+    }
+    return true;
+}
+
+bool TruthTable::isNegUnate(std::size_t var) const
+{
+    Words neg = cofactor(table, var, false), pos = cofactor(table, var, true);
+    for (std::size_t w = 0; w < table.size(); ++w)
+    {
+        if (pos[w] & ~neg[w])
+            return false;
+    }
+    return true;
+}
+
+bool TruthTable::isNESymmetric(std::size_t var1, std::size_t var2) const
+{
+    return cofactor(cofactor(table, var1, true), var2, false) == cofactor(cofactor(table, var1, false), var2, true);
+}
+
+bool TruthTable::isESymmetric(std::size_t var1, std::size_t var2) const
+{
+    return cofactor(cofactor(table, var1, false), var2, false) == cofactor(cofactor(table, var1, true), var2, true);
+}
+
+bool TruthTable::isSVSymmetric(std::size_t var, std::size_t other, bool value) const
+{
+    Words restricted = cofactor(table, other, value);
+    return cofactor(restricted, var, false) == cofactor(restricted, var, true);
+}
+
+CanonicalForm TruthTable::getCanonicalForm() const
+{
+    CanonicalForm form = {table, {}, 0};
+    if (num_inputs == 0 || num_inputs > max_canonical_inputs)
+        return form;
+
+    //the canonizer keeps its scratch tables in static storage
+    static std::mutex canonicize_mutex;
+    char perm[max_canonical_inputs];
+    {
+        std::lock_guard<std::mutex> lock(canonicize_mutex);
+        form.phase = Abc_TtCanonicize(form.table.data(), num_inputs, perm);
+    }
+    form.perm.assign(perm, perm + num_inputs);
+    return form;
+}
+
+bool TruthTable::isPermutationOf(const TruthTable &other, const std::vector<std::size_t> &var_map) const
+{
+    if (num_inputs != other.num_inputs || var_map.size() != num_inputs)
+        return false;
+
+    for (std::size_t minterm = 0; minterm < (std::size_t(1) << num_inputs); ++minterm)
+    {
+        std::size_t other_minterm = 0;
+        for (std::size_t var = 0; var < num_inputs; ++var)
+            other_minterm |= ((minterm >> var) & 1) << var_map[var];
+        if (getBit(minterm) != other.getBit(other_minterm))
+            return false;
+    }
+    return true;
+}
+
+bool TruthTable::getBit(std::size_t minterm) const
+{
+    return (table[minterm >> word_vars] >> (minterm & 63)) & 1;
+}
+
+Words TruthTable::cofactor(const Words &words, std::size_t var, bool value) const
+{
+    Words result(words.size());
+    if (var < word_vars)
+    {
+        const Word mask = variableMask(var);
+        const std::size_t shift = std::size_t(1) << var;
+        for (std::size_t w = 0; w < words.size(); ++w)
+        {
+            Word half = words[w] & (value ? mask : ~mask);
+            result[w] = value ? (half | (half >> shift)) : (half | (half << shift));
+        }
+    }
+    else
+    {
+        const std::size_t stride = std::size_t(1) << (var - word_vars);
+        for (std::size_t w = 0; w < words.size(); ++w)
+            result[w] = words[value ? (w | stride) : (w & ~stride)];
+    }
+    return result;
+}
+
+Word TruthTable::variableMask(std::size_t var)
+{
+    static const Word masks[word_vars] =
+    {
+        0xAAAAAAAAAAAAAAAAULL,
+        0xCCCCCCCCCCCCCCCCULL,
+        0xF0F0F0F0F0F0F0F0ULL,
+        0xFF00FF00FF00FF00ULL,
+        0xFFFF0000FFFF0000ULL,
+        0xFFFFFFFF00000000ULL
+    };
+    return masks[var];
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "circuit.h"
+#include "bit_simulator.h"
+
+/// NPN-каноническая форма: f(x) = C(x[perm[0]] ^ phase_0, ..., x[perm[n - 1]] ^ phase_{n - 1}) ^ phase_n
+struct CanonicalForm
+{
+    Words table; ///< Таблица истинности C
+    std::vector<std::size_t> perm; ///< perm[k] - номер входа, поставленного на k-ю позицию
+    unsigned phase; ///< Разряды 0..n-1 - инверсии входов по позициям, разряд n - инверсия выхода
+
+    std::uint64_t getKey() const; ///< Ненулевой хеш таблицы и фаз
+};
+
+/// Полная таблица истинности конуса с небольшим носителем; разряд m соответствует набору,
+/// в котором вход с номером i равен i-му разряду m (номера входов - как в BitSimulator)
+class TruthTable
+{
+public:
+    TruthTable(const Circuit *cone); ///< Исчерпывающая поразрядно-параллельная симуляция единственного выхода конуса
+
+    static constexpr std::size_t max_supported_inputs = 24;
+    static constexpr std::size_t max_canonical_inputs = 16; ///< Ограничение Abc_TtCanonicize
+    static void setMaxInputs(std::size_t num_inputs); ///< Порог носителя, до которого используется таблица; 0 - не использовать
+    static std::size_t getMaxInputs();
+    static bool isApplicable(const Circuit *cone);
+
+    std::size_t getInputCount() const;
+    std::size_t getInputIndex(const std::string &pi) const; ///< Номер входа или BitSimulator::npos
+    const std::string &getInputName(std::size_t var) const;
+    const Words &getWords() const;
+
+    bool isPosUnate(std::size_t var) const; ///< f|var=0 <= f|var=1
+    bool isNegUnate(std::size_t var) const; ///< f|var=1 <= f|var=0
+    bool isNESymmetric(std::size_t var1, std::size_t var2) const; ///< f|var1=1,var2=0 = f|var1=0,var2=1
+    bool isESymmetric(std::size_t var1, std::size_t var2) const; ///< f|var1=0,var2=0 = f|var1=1,var2=1
+    bool isSVSymmetric(std::size_t var, std::size_t other, bool value) const; ///< f не зависит от var при other = value
+
+    CanonicalForm getCanonicalForm() const; ///< Полуканоническая форма ABC: равные формы не гарантированы для всех NPN-эквивалентных функций
+    bool isPermutationOf(const TruthTable &other, const std::vector<std::size_t> &var_map) const; ///< f(x) = other(z), где z[var_map[i]] = x[i]
+private:
+    std::vector<std::string> input_names;
+    std::map<std::string, std::size_t> input_index;
+    std::size_t num_inputs;
+    Words table;
+
+    static std::size_t max_inputs;
+
+    bool getBit(std::size_t minterm) const;
+    Words cofactor(const Words &words, std::size_t var, bool value) const; ///< Таблица той же длины, где var заменён константой
+    static Word variableMask(std::size_t var); ///< Разряды слова, в которых var = 1 (var < 6)
+};
@@ -1,4 +1,6 @@
 #include "validator.h"
+#include "stimulus.h"
+#include "simulation_budget.h"
 
 ValidationResult Validator::validateMatching(Circuit *cir1, Circuit *cir2, const SignData &signs1, const SignData &signs2, const Matching &output_matching)
 {
@@ -75,8 +77,10 @@ std::vector<IOSet> Validator::partitionType1(Circuit *cir, const std::vector<IOS
 {
     std::vector<IOSet> new_partition = partition;
     const auto &po = cir->getOutputs().front();
+    Stimulus stimulus(cir->getName(), po, "type1");
     constexpr std::size_t max_it = 10000;
-    for (std::size_t it = 0; it < max_it && new_partition.size() == partition.size(); ++it)
+    for (SimulationBudget budget(max_it); !budget.isExhausted() && new_partition.size() == partition.size();
+         budget.update(new_partition.size() != partition.size()))
     {
         new_partition.clear();
         for (std::size_t i = 0; i < partition.size(); ++i)
@@ -87,7 +91,7 @@ std::vector<IOSet> Validator::partitionType1(Circuit *cir, const std::vector<IOS
             InVector in_vec;
             for (std::size_t j = 0; j < partition.size(); ++j)
             {
-                bool value = (rand() % 2) == 0;
+                bool value = stimulus.nextBool();
                 for (const auto &pi : partition[j])
                     in_vec.insert({pi, value});
             }
@@ -114,8 +118,10 @@ std::vector<IOSet> Validator::partitionType2(Circuit *cir, const std::vector<IOS
 {
     std::vector<IOSet> new_partition = partition;
     const auto &po = cir->getOutputs().front();
+    Stimulus stimulus(cir->getName(), po, "type2");
     constexpr std::size_t max_it = 10000;
-    for (std::size_t it = 0; it < max_it && new_partition.size() == partition.size(); ++it)
+    for (SimulationBudget budget(max_it); !budget.isExhausted() && new_partition.size() == partition.size();
+         budget.update(new_partition.size() != partition.size()))
     {
         new_partition.clear();
         for (std::size_t i = 0; i < partition.size(); ++i)
@@ -126,7 +132,7 @@ std::vector<IOSet> Validator::partitionType2(Circuit *cir, const std::vector<IOS
             InVector in_vec;
             for (std::size_t j = 0; j < partition.size(); ++j)
             {
-                bool value = (rand() % 2) == 0;
+                bool value = stimulus.nextBool();
                 for (const auto &pi : partition[j])
                     in_vec.insert({pi, value});
             }
@@ -0,0 +1,108 @@
+#include "walsh_spectrum.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cstdlib>
+
+constexpr std::size_t WalshSpectrum::max_supported_inputs;
+std::size_t WalshSpectrum::max_inputs = max_supported_inputs;
+
+namespace
+{
+    constexpr std::size_t block_size = std::size_t(1) << 14; //stages inside a block stay in cache
+
+    std::uint64_t mix(std::uint64_t x)
+    {
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+    }
+
+    void butterflies(std::int32_t *low, std::int32_t *high, std::size_t count)
+    {
+        for (std::size_t j = 0; j < count; ++j)
+        {
+            const std::int32_t a = low[j], b = high[j];
+            low[j] = a + b;
+            high[j] = a - b;
+        }
+    }
+}
+
+WalshSpectrum::WalshSpectrum(const TruthTable &table) :
+    num_inputs(table.getInputCount()),
+    coefficients(std::size_t(1) << num_inputs)
+{
+    const Words &words = table.getWords();
+    const std::size_t size = coefficients.size(), block = std::min(size, block_size);
+    std::int32_t *c = coefficients.data();
+    for (std::size_t x = 0; x < size; ++x)
+        c[x] = ((words[x >> 6] >> (x & 63)) & 1) ? -1 : 1;
+
+    //short strides are finished block by block, longer ones are split into runs of one block
+    parallelFor(size / block, [c, block](std::size_t b)
+    {
+        std::int32_t *base = c + b * block;
+        for (std::size_t h = 1; h < block; h <<= 1)
+        {
+            for (std::size_t i = 0; i < block; i += 2 * h)
+                butterflies(base + i, base + i + h, h);
+        }
+    });
+    for (std::size_t h = block; h < size; h <<= 1)
+    {
+        parallelFor(size / 2 / block, [c, block, h](std::size_t t)
+        {
+            const std::size_t p = t * block, j = p / h * 2 * h + p % h;
+            butterflies(c + j, c + j + h, block);
+        });
+    }
+}
+
+void WalshSpectrum::setMaxInputs(std::size_t num_inputs)
+{
+    max_inputs = std::min(num_inputs, max_supported_inputs);
+}
+
+std::size_t WalshSpectrum::getMaxInputs()
+{
+    return max_inputs;
+}
+
+bool WalshSpectrum::isApplicable(const Circuit *cone)
+{
+    return cone->getInputs().size() <= max_inputs && !cone->getInputs().empty() && cone->getOutputs().size() == 1;
+}
+
+std::int32_t WalshSpectrum::getCoefficient(std::size_t u) const
+{
+    return coefficients.at(u);
+}
+
+std::uint64_t WalshSpectrum::getOrderSignature() const
+{
+    //a sum of hashes does not depend on the order of coefficients inside each order
+    const std::size_t size = coefficients.size(), block = std::min(size, block_size);
+    std::vector<std::uint64_t> sums(size / block, 0);
+    parallelFor(sums.size(), [&](std::size_t b)
+    {
+        for (std::size_t u = b * block; u < (b + 1) * block; ++u)
+            sums[b] += mix((static_cast<std::uint64_t>(__builtin_popcountll(u)) << 32) | std::abs(coefficients[u]));
+    });
+
+    std::uint64_t signature = 0;
+    for (auto sum : sums)
+        signature += sum;
+    return mix(signature ^ num_inputs);
+}
+
+std::uint64_t WalshSpectrum::getInputSignature(std::size_t var) const
+{
+    const std::size_t u = std::size_t(1) << var;
+    std::uint64_t pairs = 0;
+    for (std::size_t other = 0; other < num_inputs; ++other)
+    {
+        if (other != var)
+            pairs += mix(std::abs(coefficients[u | (std::size_t(1) << other)]));
+    }
+    return mix(mix(std::abs(coefficients[u])) ^ pairs);
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "truth_table.h"
+
+/// Спектр Уолша-Адамара функции конуса: W(u) = sum_x (-1)^(f(x) ^ <u, x>), номера входов - как в TruthTable.
+/// Сигнатуры строятся по модулям коэффициентов, поэтому не зависят от перестановки и инверсии входов и от инверсии выхода
+class WalshSpectrum
+{
+public:
+    WalshSpectrum(const TruthTable &table); ///< Быстрое преобразование на месте, O(n 2^n)
+
+    static constexpr std::size_t max_supported_inputs = 20; ///< 2^20 коэффициентов int32 - 4 МБ на конус в каждом потоке
+
+    static void setMaxInputs(std::size_t num_inputs); ///< Порог носителя, до которого вычисляется спектр (не больше max_supported_inputs); 0 - не вычислять
+    static std::size_t getMaxInputs();
+    static bool isApplicable(const Circuit *cone);
+
+    std::int32_t getCoefficient(std::size_t u) const;
+    std::uint64_t getOrderSignature() const; ///< Гистограммы модулей коэффициентов каждого порядка |u|
+    std::uint64_t getInputSignature(std::size_t var) const; ///< |W(var)| и гистограмма модулей коэффициентов второго порядка, содержащих var
+private:
+    std::size_t num_inputs;
+    std::vector<std::int32_t> coefficients;
+
+    static std::size_t max_inputs;
+};
@@ -0,0 +1,110 @@
+#include "weight_profile.h"
+#include "truth_table.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+constexpr std::size_t WeightProfile::num_classes;
+constexpr std::size_t WeightProfile::num_buckets;
+constexpr std::size_t WeightProfile::num_words;
+constexpr double WeightProfile::margin_deviations;
+
+WeightProfile::WeightProfile(const Circuit *cone) :
+    exact(TruthTable::isApplicable(cone))
+{
+    if (exact)
+    {
+        //every minterm of weight k counts, so the profile has no sampling noise
+        TruthTable table(cone);
+        const std::size_t num_inputs = table.getInputCount();
+        std::vector<std::uint64_t> ones(num_inputs + 1, 0);
+        const Words &words = table.getWords();
+        for (std::size_t minterm = 0; minterm < (std::size_t(1) << num_inputs); ++minterm)
+        {
+            if ((words[minterm >> 6] >> (minterm & 63)) & 1)
+                ++ones[__builtin_popcountll(minterm)];
+        }
+        for (std::size_t cls = 0; cls < num_classes; ++cls)
+        {
+            weights.push_back(getClassWeight(cls, num_inputs));
+            class_keys.push_back(ones[weights.back()]);
+        }
+        return;
+    }
+
+    BitSimulator sim(cone);
+    Stimulus stimulus(cone->getName(), cone->getOutputs().front(), "weight");
+    sim.setWordCount(num_words);
+
+    for (std::size_t cls = 0; cls < num_classes; ++cls)
+    {
+        weights.push_back(getClassWeight(cls, sim.getInputCount()));
+        generatePatterns(sim, stimulus, weights.back());
+        sim.simulate();
+        class_keys.push_back(getRateBucket(sim.getOutputWords()));
+    }
+}
+
+std::size_t WeightProfile::getClassWeight(std::size_t cls, std::size_t num_inputs)
+{
+    return (num_inputs * cls + (num_classes - 1) / 2) / (num_classes - 1);
+}
+
+void WeightProfile::generatePatterns(BitSimulator &sim, Stimulus &stimulus, std::size_t weight)
+{
+    //a partial shuffle picks the minority value positions of every pattern, the rest get the majority value
+    const std::size_t num_inputs = sim.getInputCount(), num_sim_words = sim.getWordCount();
+    const bool minority = weight * 2 <= num_inputs;
+    const std::size_t num_picked = minority ? weight : num_inputs - weight;
+    std::vector<std::size_t> order(num_inputs);
+    for (std::size_t i = 0; i < num_inputs; ++i)
+        std::fill(sim.getInputWords(i), sim.getInputWords(i) + num_sim_words, minority ? 0 : ~0ULL);
+    for (std::size_t w = 0; w < num_sim_words; ++w)
+    {
+        for (std::size_t bit = 0; bit < 64; ++bit)
+        {
+            std::iota(order.begin(), order.end(), 0);
+            for (std::size_t t = 0; t < num_picked; ++t)
+            {
+                std::swap(order[t], order[t + stimulus.nextWord() % (num_inputs - t)]);
+                sim.getInputWords(order[t])[w] ^= 1ULL << bit;
+            }
+        }
+    }
+}
+
+std::size_t WeightProfile::getRateBucket(const Word *words)
+{
+    std::size_t ones = 0;
+    for (std::size_t w = 0; w < num_words; ++w)
+        ones += __builtin_popcountll(words[w]);
+
+    //the deviation is bounded from below so that rates close to 0 or 1 keep a margin too
+    const double num_patterns = num_words * 64, rate = ones / num_patterns,
+                 deviation = std::sqrt(std::max(rate * (1 - rate), 1 / num_patterns) / num_patterns);
+    const std::size_t bucket = std::min(static_cast<std::size_t>(rate * num_buckets), num_buckets - 1);
+    const double lower = static_cast<double>(bucket) / num_buckets, upper = static_cast<double>(bucket + 1) / num_buckets;
+    const bool ambiguous = (bucket > 0 && rate - lower < margin_deviations * deviation) ||
+                           (bucket + 1 < num_buckets && upper - rate < margin_deviations * deviation);
+    return ambiguous ? BitSimulator::npos : bucket;
+}
+
+std::size_t WeightProfile::getWeight(std::size_t cls) const
+{
+    return weights.at(cls);
+}
+
+bool WeightProfile::isExact() const
+{
+    return exact;
+}
+
+bool WeightProfile::isAmbiguous(std::size_t cls) const
+{
+    return !exact && class_keys.at(cls) == BitSimulator::npos;
+}
+
+std::uint64_t WeightProfile::getClassKey(std::size_t cls) const
+{
+    return class_keys.at(cls);
+}
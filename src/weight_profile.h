@@ -0,0 +1,31 @@
+#pragma once
+
+#include "circuit.h"
+#include "bit_simulator.h"
+
+/// Доли единиц выхода на шаблонах ровно с k единицами среди входов конуса, k = n * j / (num_classes - 1);
+/// не зависят от перестановки входов, поэтому сравнимы между схемами до уточнения разбиений входов.
+/// Для конусов с таблицей истинности считаются точно по всем наборам веса k, иначе оцениваются по случайным шаблонам
+class WeightProfile
+{
+public:
+    WeightProfile(const Circuit *cone); ///< Поток шаблонов определяется именем единственного выхода конуса
+
+    static constexpr std::size_t num_classes = 9;
+    static constexpr std::size_t num_buckets = 8; ///< Доля единиц округляется до корзины равной ширины
+    static constexpr std::size_t num_words = 64; ///< Шаблоны одного класса
+    static constexpr double margin_deviations = 6; ///< Оценка ближе стольких стандартных отклонений к границе корзины неоднозначна
+
+    std::size_t getWeight(std::size_t cls) const; ///< Число единиц среди входов в шаблонах класса
+    bool isExact() const;
+    bool isAmbiguous(std::size_t cls) const; ///< Только для оценок по случайным шаблонам
+    std::uint64_t getClassKey(std::size_t cls) const; ///< Точное число наборов веса k с единицей на выходе или номер корзины оценки
+private:
+    std::vector<std::size_t> weights;
+    bool exact;
+    std::vector<std::uint64_t> class_keys; ///< Для оценок BitSimulator::npos - корзина неоднозначна
+
+    static std::size_t getClassWeight(std::size_t cls, std::size_t num_inputs);
+    static void generatePatterns(BitSimulator &sim, Stimulus &stimulus, std::size_t weight); ///< Все слова sim, ровно weight единиц в каждом шаблоне
+    static std::size_t getRateBucket(const Word *words); ///< Корзина доли единиц в num_words словах или BitSimulator::npos
+};